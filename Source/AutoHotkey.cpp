@@ -18,6 +18,7 @@ GNU General Public License for more details.
 #include "globaldata.h" // for access to many global vars
 #include "application.h" // for MsgSleep()
 #include "window.h" // For MsgBox() & SetForegroundLockTimeout()
+#include "profiler.h" // For the /Profile and /Counters switches.
 
 // General note:
 // The use of Sleep() should be avoided *anywhere* in the code.  Instead, call MsgSleep().
@@ -32,6 +33,7 @@ int WINAPI WinMain (HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLin
 	// Init any globals not in "struct g" that need it:
 	g_hInstance = hInstance;
 	InitializeCriticalSection(&g_CriticalRegExCache); // v1.0.45.04: Must be done early so that it's unconditional, so that DeleteCriticalSection() in the script destructor can also be unconditional (deleting when never initialized can crash, at least on Win 9x).
+	InitializeCriticalSection(&g_CriticalLayoutCache); // Same.
 
 	if (!GetCurrentDirectory(sizeof(g_WorkingDir), g_WorkingDir)) // Needed for the FileSelectFile() workaround.
 		*g_WorkingDir = '\0';
@@ -110,6 +112,28 @@ int WINAPI WinMain (HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLin
 			if (   !(g_script.mIncludeLibraryFunctionsThenExit = fopen(__argv[i], "w"))   ) // Can't open the temp file.
 				return CRITICAL_ERROR;
 		}
+		else if (!stricmp(param, "/Profile")) // Enable the sampling profiler (see profiler.h).
+		{
+			++i; // Consume the next parameter too, because it's the file to which the report is written.
+			if (i >= __argc) // Missing the expected filename parameter.
+				return CRITICAL_ERROR;
+			ScriptProfiler::SetOutputFile(__argv[i]);
+		}
+		else if (!stricmp(param, "/ProfileInterval")) // Sampling interval in milliseconds for the above.
+		{
+			++i;
+			if (i >= __argc)
+				return CRITICAL_ERROR;
+			ScriptProfiler::SetInterval(ATOU(__argv[i]));
+		}
+		else if (!stricmp(param, "/Counters")) // Count executed lines, expression tokens, etc. (see profiler.h).
+		{
+			++i; // Consume the next parameter too, because it's the file to which the report is written.
+			if (i >= __argc)
+				return CRITICAL_ERROR;
+			if (!ScriptCounters::Start(__argv[i]))
+				return CRITICAL_ERROR;
+		}
 #endif
 		else // since this is not a recognized switch, the end of the [Switches] section has been reached (by design).
 		{
@@ -172,6 +196,7 @@ int WINAPI WinMain (HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLin
 #endif
 	if (load_result == LOADING_FAILED) // Error during load (was already displayed by the function call).
 		return CRITICAL_ERROR;  // Should return this value because PostQuitMessage() also uses it.
+	ScriptCounters::LoadFinished();
 	if (!load_result) // LoadFromFile() relies upon us to do this check.  No lines were loaded, so we're done.
 		return 0;
 
@@ -293,6 +318,11 @@ int WINAPI WinMain (HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLin
 		// don't write-cache it either.
 		clipboard_var->DisableCache();
 
+	// Start sampling only now so that the time spent loading the script and creating windows isn't
+	// charged to the script's first line:
+	if (ScriptProfiler::IsEnabled())
+		ScriptProfiler::Start();
+
 	// Run the auto-execute part at the top of the script (this call might never return):
 	if (!g_script.AutoExecSection()) // Can't run script at all. Due to rarity, just abort.
 		return CRITICAL_ERROR;
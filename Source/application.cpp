@@ -55,6 +55,14 @@ bool MsgSleep(int aSleepDuration, MessageMode aMode)
 	// to close the clipboard now that Line::ExecUntil() also calls CLOSE_CLIPBOARD_IF_OPEN:
 	CLOSE_CLIPBOARD_IF_OPEN;
 
+	// Close any files FileAppend has kept open but isn't actively using.  If the script is about to wait
+	// (idle or a long Sleep), close all of them so that they aren't held open while nothing is being written:
+	CloseCachedAppendFiles(NULL, (aMode == WAIT_FOR_MESSAGES || aSleepDuration > FILE_APPEND_CACHE_TIMEOUT)
+		? 0 : FILE_APPEND_CACHE_TIMEOUT);
+	// Similarly, release the screen capture kept by PixelSearch/ImageSearch once the script is idle:
+	if (aMode == WAIT_FOR_MESSAGES)
+		FreeScreenCapture();
+
 	// While in mode RETURN_AFTER_MESSAGES, there are different things that can happen:
 	// 1) We launch a new hotkey subroutine, interrupting/suspending the old one.  But
 	//    subroutine calls this function again, so now it's recursed.  And thus the
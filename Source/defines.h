@@ -131,8 +131,8 @@ enum StringCaseSenseType {SCS_INSENSITIVE, SCS_SENSITIVE, SCS_INSENSITIVE_LOCALE
 
 enum SymbolType // For use with ExpandExpression() and IsPureNumeric().
 {
-	// The sPrecedence array in ExpandExpression() must be kept in sync with any additions, removals,
-	// or re-ordering of the below.  Also, IS_OPERAND() relies on all operand types being at the
+	// The sPrecedence array in ExpandExpression() (and sSymbolName in profiler.cpp) must be kept in sync
+	// with any additions, removals, or re-ordering of the below.  Also, IS_OPERAND() relies on all operand types being at the
 	// beginning of the list:
 	 PURE_NOT_NUMERIC // Must be zero/false because callers rely on that.
 	, PURE_INTEGER, PURE_FLOAT
@@ -30,6 +30,7 @@ HINSTANCE g_hInstance = NULL; // Set by WinMain().
 DWORD g_MainThreadID = GetCurrentThreadId();
 DWORD g_HookThreadID; // Not initialized by design because 0 itself might be a valid thread ID.
 CRITICAL_SECTION g_CriticalRegExCache;
+CRITICAL_SECTION g_CriticalLayoutCache;
 
 bool g_DestroyWindowCalled = false;
 HWND g_hWnd = NULL;
@@ -751,6 +752,7 @@ int g_key_to_sc_count = sizeof(g_key_to_sc) / sizeof(key_to_sc_type);
 
 KeyHistoryItem *g_KeyHistory = NULL; // Array is allocated during startup.
 int g_KeyHistoryNext = 0;
+HookStats g_HookStats = {0};
 
 #ifdef ENABLE_KEY_HISTORY_FILE
 bool g_KeyHistoryToFile = false;
@@ -26,6 +26,7 @@ extern HINSTANCE g_hInstance;
 extern DWORD g_MainThreadID;
 extern DWORD g_HookThreadID;
 extern CRITICAL_SECTION g_CriticalRegExCache;
+extern CRITICAL_SECTION g_CriticalLayoutCache;
 
 extern bool g_DestroyWindowCalled;
 extern HWND g_hWnd;  // The main window
@@ -184,6 +185,7 @@ extern DWORD g_HistoryTickNow;
 extern DWORD g_HistoryTickPrev;
 extern HWND g_HistoryHwndPrev;
 extern DWORD g_TimeLastInputPhysical;
+extern HookStats g_HookStats;
 
 #ifdef ENABLE_KEY_HISTORY_FILE
 extern bool g_KeyHistoryToFile;
@@ -123,6 +123,8 @@ static modLR_type sPriorModifiersLR_physical;
 static BYTE sPriorShiftState;
 static BYTE sPriorLShiftState;
 
+static HotkeyIDType sStatsHotkeyID; // The hotkey (if any) triggered by the event being timed.  See HookStatsRecord().
+
 enum DualNumpadKeys	{PAD_DECIMAL, PAD_NUMPAD0, PAD_NUMPAD1, PAD_NUMPAD2, PAD_NUMPAD3
 , PAD_NUMPAD4, PAD_NUMPAD5, PAD_NUMPAD6, PAD_NUMPAD7, PAD_NUMPAD8, PAD_NUMPAD9
 , PAD_DELETE, PAD_INSERT, PAD_END, PAD_DOWN, PAD_NEXT, PAD_LEFT, PAD_CLEAR
@@ -155,11 +157,51 @@ inline bool IsIgnored(ULONG_PTR aExtraInfo)
 
 
 
+static void HookStatsRecord(const LARGE_INTEGER &aStart, LRESULT aResult, vk_type aVK, sc_type aSC
+	, bool aKeyUp, bool aIsMouse)
+// Adds an event whose processing began at aStart to g_HookStats.  Called only by the hook thread.
+{
+	static LONGLONG sFrequency = 0;
+	LARGE_INTEGER now;
+	QueryPerformanceCounter(&now);
+	if (!sFrequency && (!QueryPerformanceFrequency((LARGE_INTEGER *)&sFrequency) || !sFrequency))
+		sFrequency = 1000000; // No high-resolution counter, in which case QueryPerformanceCounter() yields zero, so all times will be zero.
+	DWORD microseconds = (DWORD)((now.QuadPart - aStart.QuadPart) * 1000000 / sFrequency);
+
+	int i;
+	for (i = 0; i < HOOK_LATENCY_BUCKETS - 1 && microseconds >= (1UL << i); ++i);
+	++g_HookStats.histogram[aIsMouse][i];
+	// A non-zero result means the event was blocked, either by us or by a hook further down the chain:
+	if (aResult)
+		++g_HookStats.suppressed[aIsMouse];
+	else
+		++g_HookStats.passed[aIsMouse];
+
+	// Keep a record of the slowest events, since those are the ones that risk having the OS remove the hook:
+	HookSlowEvent *slowest = g_HookStats.slowest; // For brevity.
+	if (microseconds <= slowest[HOOK_SLOWEST_EVENTS - 1].microseconds) // Not slow enough to make the list.
+		return;
+	for (i = HOOK_SLOWEST_EVENTS - 1; i > 0 && slowest[i - 1].microseconds < microseconds; --i)
+		slowest[i] = slowest[i - 1]; // Make room by shifting faster items down.
+	HookSlowEvent &item = slowest[i];
+	item.microseconds = microseconds;
+	item.hotkey_id = sStatsHotkeyID;
+	item.vk = aVK;
+	item.sc = aSC;
+	item.key_up = aKeyUp;
+	item.is_mouse = aIsMouse;
+}
+
+
+
 LRESULT CALLBACK LowLevelKeybdProc(int aCode, WPARAM wParam, LPARAM lParam)
 {
 	if (aCode != HC_ACTION)  // MSDN docs specify that both LL keybd & mouse hook should return in this case.
 		return CallNextHookEx(g_KeybdHook, aCode, wParam, lParam);
 
+	LARGE_INTEGER start_time; // For HookStatsRecord().
+	QueryPerformanceCounter(&start_time);
+
 	KBDLLHOOKSTRUCT &event = *(PKBDLLHOOKSTRUCT)lParam;  // For convenience, maintainability, and possibly performance.
 
 	// Change the event to be physical if that is indicated in its dwExtraInfo attribute.
@@ -281,7 +323,10 @@ LRESULT CALLBACK LowLevelKeybdProc(int aCode, WPARAM wParam, LPARAM lParam)
 		}
 	} // if (vk == VK_LCONTROL)
 
-	return LowLevelCommon(g_KeybdHook, aCode, wParam, lParam, vk, sc, key_up, event.dwExtraInfo, event.flags);
+	sStatsHotkeyID = HOTKEY_ID_INVALID; // SuppressThisKeyFunc() or AllowIt() will change it if a hotkey fires.
+	LRESULT result = LowLevelCommon(g_KeybdHook, aCode, wParam, lParam, vk, sc, key_up, event.dwExtraInfo, event.flags);
+	HookStatsRecord(start_time, result, vk, sc, key_up, false);
+	return result;
 }
 
 
@@ -315,6 +360,9 @@ LRESULT CALLBACK LowLevelMouseProc(int aCode, WPARAM wParam, LPARAM lParam)
 		// movement, even if that movement came from a source other than an AHK script (such as some other
 		// macro program).
 
+	LARGE_INTEGER start_time; // For HookStatsRecord().  Mouse movement isn't timed because it's so frequent and so trivial (above).
+	QueryPerformanceCounter(&start_time);
+
 	// MSDN: WM_LBUTTONDOWN, WM_LBUTTONUP, WM_MOUSEMOVE, WM_MOUSEWHEEL [, WM_MOUSEHWHEEL], WM_RBUTTONDOWN, or WM_RBUTTONUP.
 	// But what about the middle button?  It's undocumented, but it is received.
 	// What about doubleclicks (e.g. WM_LBUTTONDBLCLK): I checked: They are NOT received.
@@ -359,7 +407,10 @@ LRESULT CALLBACK LowLevelMouseProc(int aCode, WPARAM wParam, LPARAM lParam)
 		case WM_XBUTTONDOWN: vk = (HIWORD(event.mouseData) == XBUTTON1) ? VK_XBUTTON1 : VK_XBUTTON2; key_up = false; break;
 	}
 
-	return LowLevelCommon(g_MouseHook, aCode, wParam, lParam, vk, sc, key_up, event.dwExtraInfo, event.flags);
+	sStatsHotkeyID = HOTKEY_ID_INVALID; // SuppressThisKeyFunc() or AllowIt() will change it if a hotkey fires.
+	LRESULT result = LowLevelCommon(g_MouseHook, aCode, wParam, lParam, vk, sc, key_up, event.dwExtraInfo, event.flags);
+	HookStatsRecord(start_time, result, vk, sc, key_up, true);
+	return result;
 }
 
 
@@ -2139,6 +2190,7 @@ LRESULT SuppressThisKeyFunc(const HHOOK aHook, LPARAM lParam, const vk_type aVK,
 // might have adjusted vk, namely to make it a left/right specific modifier key rather than a
 // neutral one.
 {
+	sStatsHotkeyID = aHotkeyIDToPost;
 	if (pKeyHistoryCurr->event_type == ' ') // then it hasn't been already set somewhere else
 		pKeyHistoryCurr->event_type = 's';
 	// This handles the troublesome Numlock key, which on some (most/all?) keyboards
@@ -2209,6 +2261,7 @@ LRESULT AllowIt(const HHOOK aHook, int aCode, WPARAM wParam, LPARAM lParam, cons
 // might have adjusted vk, namely to make it a left/right specific modifier key rather than a
 // neutral one.
 {
+	sStatsHotkeyID = aHotkeyIDToPost;
 	WPARAM hs_wparam_to_post = HOTSTRING_INDEX_INVALID; // Set default.
 	LPARAM hs_lparam_to_post; // Not initialized because the above is the sole indicator of whether its contents should even be examined.
 
@@ -2715,8 +2768,29 @@ bool CollectInput(KBDLLHOOKSTRUCT &aEvent, const vk_type aVK, const sc_type aSC,
 			// Searching through the hot strings in the original, physical order is the documented
 			// way in which precedence is determined, i.e. the first match is the only one that will
 			// be triggered.
-			for (HotstringIDType u = 0; u < Hotstring::sHotstringCount; ++u)
+			// Rather than checking every hotstring, check only the two chains that can possibly match:
+			// hotstrings without an ending char whose abbreviation ends in the char just typed, and
+			// (if the char just typed is an ending char) hotstrings requiring one whose abbreviation ends
+			// in the char before it.  Both chains are sorted by ID, so merging them visits candidates in
+			// the same order as a search of the whole list would.
+			HotstringIDType u, next_u = Hotstring::sFirstByLastChar[0][(UCHAR)(size_t)ltolower(g_HSBuf[g_HSBufLength - 1])]
+				, next_u_end_char = (g_HSBufLength > 1 && strchr(g_EndChars, g_HSBuf[g_HSBufLength - 1]))
+					? Hotstring::sFirstByLastChar[1][(UCHAR)(size_t)ltolower(g_HSBuf[g_HSBufLength - 2])]
+					: HOTSTRING_ID_NONE;
+			for (;;)
 			{
+				if (next_u < next_u_end_char)
+				{
+					u = next_u;
+					next_u = shs[u]->mNextWithSameLastChar;
+				}
+				else if (next_u_end_char != HOTSTRING_ID_NONE)
+				{
+					u = next_u_end_char;
+					next_u_end_char = shs[u]->mNextWithSameLastChar;
+				}
+				else // Both chains are exhausted (HOTSTRING_ID_NONE is greater than any valid ID).
+					break;
 				Hotstring &hs = *shs[u];  // For performance and convenience.
 				if (hs.mSuspended)
 					continue;
@@ -3018,6 +3092,7 @@ bool CollectInput(KBDLLHOOKSTRUCT &aEvent, const vk_type aVK, const sc_type aSC,
 	// in progress (which we know is the case otherwise other opportunities to return above would
 	// have done so).  Hotstrings (if any) have already been fully handled by the above.
 
+	int prev_buffer_length = g_input.BufferLength; // Used by the match-list section below.
 	#define ADD_INPUT_CHAR(ch) \
 		if (g_input.BufferLength < g_input.BufferLengthMax)\
 		{\
@@ -3038,60 +3113,28 @@ bool CollectInput(KBDLLHOOKSTRUCT &aEvent, const vk_type aVK, const sc_type aSC,
 	// else even if BufferLengthMax has been reached, check if there's a match because a match should take
 	// precedence over the length limit.
 
-	// Otherwise, check if the buffer now matches any of the key phrases:
+	// Otherwise, check if the buffer now matches any of the key phrases.  For the "*" option, a phrase
+	// that lies entirely within the part of the buffer that was already there would have terminated the
+	// input when it was typed (and backspacing can't create a new substring), so only phrases that end
+	// at one of the chars just added need to be checked.  For an exact match, the phrase must end at
+	// the end of the buffer.  Either way, InputMatchEndsAt() checks only phrases ending in the right char.
 	if (g_input.FindAnywhere)
 	{
-		if (g_input.CaseSensitive)
+		for (int end = prev_buffer_length + 1; end <= g_input.BufferLength; ++end)
 		{
-			for (UINT i = 0; i < g_input.MatchCount; ++i)
+			if (InputMatchEndsAt(end))
 			{
-				if (strstr(g_input.buffer, g_input.match[i]))
-				{
-					g_input.status = INPUT_TERMINATED_BY_MATCH;
-					return treat_as_visible;
-				}
-			}
-		}
-		else // Not case sensitive.
-		{
-			for (UINT i = 0; i < g_input.MatchCount; ++i)
-			{
-				// v1.0.43.03: Changed lstrcasestr to strcasestr because it seems unlikely to break any existing
-				// scripts and is also more useful given that that Input with match-list is pretty rarely used,
-				// and even when it is used, match lists are usually short (so performance isn't impacted much
-				// by this change).
-				if (lstrcasestr(g_input.buffer, g_input.match[i]))
-				{
-					g_input.status = INPUT_TERMINATED_BY_MATCH;
-					return treat_as_visible;
-				}
+				g_input.status = INPUT_TERMINATED_BY_MATCH;
+				return treat_as_visible;
 			}
 		}
 	}
 	else // Exact match is required
 	{
-		if (g_input.CaseSensitive)
+		if (InputMatchEndsAt(g_input.BufferLength))
 		{
-			for (UINT i = 0; i < g_input.MatchCount; ++i)
-			{
-				if (!strcmp(g_input.buffer, g_input.match[i]))
-				{
-					g_input.status = INPUT_TERMINATED_BY_MATCH;
-					return treat_as_visible;
-				}
-			}
-		}
-		else // Not case sensitive.
-		{
-			for (UINT i = 0; i < g_input.MatchCount; ++i)
-			{
-				// v1.0.43.03: Changed to locale-insensitive search.  See similar v1.0.43.03 comment above for more details.
-				if (!lstrcmpi(g_input.buffer, g_input.match[i]))
-				{
-					g_input.status = INPUT_TERMINATED_BY_MATCH;
-					return treat_as_visible;
-				}
-			}
+			g_input.status = INPUT_TERMINATED_BY_MATCH;
+			return treat_as_visible;
 		}
 	}
 
@@ -3104,6 +3147,63 @@ bool CollectInput(KBDLLHOOKSTRUCT &aEvent, const vk_type aVK, const sc_type aSC,
 
 
 
+void InputIndexMatchList()
+// Called by the Input command after it has parsed the match list and options, but before it sets
+// g_input.status to INPUT_IN_PROGRESS.  Chains the phrases together by their last char so that the
+// hook can check only the phrases that could possibly match after each keystroke (see InputMatchEndsAt).
+{
+	memset(g_input.MatchFirstByLastChar, 0xFF, sizeof(g_input.MatchFirstByLastChar)); // Set all to INPUT_MATCH_NONE.
+	char *phrase;
+	UCHAR last_char;
+	for (UINT i = g_input.MatchCount; i-- > 0;) // Backward so that each chain ends up in ascending order, which is easier to debug.
+	{
+		phrase = g_input.match[i];
+		last_char = phrase[strlen(phrase) - 1]; // Caller has ensured there are no empty phrases.
+		if (!g_input.CaseSensitive)
+			last_char = (UCHAR)(size_t)ltolower(last_char);
+		g_input.MatchNext[i] = g_input.MatchFirstByLastChar[last_char];
+		g_input.MatchFirstByLastChar[last_char] = i;
+	}
+}
+
+
+
+bool InputMatchEndsAt(int aEnd)
+// Returns true if any phrase in the match list is identical to the part of g_input.buffer that ends
+// just before position aEnd.  When an exact match is required, the phrase must also start at the
+// beginning of the buffer.  Caller has ensured that 1 <= aEnd <= g_input.BufferLength.
+{
+	char *buf_end = g_input.buffer + aEnd;
+	UCHAR last_char = buf_end[-1];
+	if (!g_input.CaseSensitive)
+		last_char = (UCHAR)(size_t)ltolower(last_char);
+	char *phrase, *cp, *cpbuf;
+	size_t phrase_length;
+	for (UINT i = g_input.MatchFirstByLastChar[last_char]; i != INPUT_MATCH_NONE; i = g_input.MatchNext[i])
+	{
+		phrase = g_input.match[i];
+		phrase_length = strlen(phrase);
+		if (g_input.FindAnywhere ? phrase_length > (size_t)aEnd : phrase_length != (size_t)aEnd)
+			continue;
+		// Compare backward from the end since the last chars are already known to match:
+		if (g_input.CaseSensitive)
+		{
+			for (cp = phrase + phrase_length - 1, cpbuf = buf_end - 1; cp >= phrase; --cp, --cpbuf)
+				if (*cp != *cpbuf)
+					break;
+		}
+		else // Case insensitive.  Like the lstrcasestr()/lstrcmpi() that were formerly used, this obeys the locale.
+			for (cp = phrase + phrase_length - 1, cpbuf = buf_end - 1; cp >= phrase; --cp, --cpbuf)
+				if (ltolower(*cp) != ltolower(*cpbuf))
+					break;
+		if (cp < phrase) // The loop above compared every char without finding a difference.
+			return true;
+	}
+	return false;
+}
+
+
+
 void UpdateKeybdState(KBDLLHOOKSTRUCT &aEvent, const vk_type aVK, const sc_type aSC, bool aKeyUp, bool aIsSuppressed)
 // Caller has ensured that vk has been translated from neutral to left/right if necessary.
 // Always use the parameter vk rather than event.vkCode because the caller or caller's caller
@@ -3588,7 +3688,7 @@ void ChangeHookState(Hotkey *aHK[], int aHK_count, HookType aWhichHook, HookType
 			|| !(ksc = new key_type[SC_ARRAY_COUNT])
 			|| !(kvkm = new HotkeyIDType[KVKM_SIZE])
 			|| !(kscm = new HotkeyIDType[KSCM_SIZE])
-			|| !(hotkey_up = new HotkeyIDType[MAX_HOTKEYS])   )
+			|| !(hotkey_up = new HotkeyIDType[HOTKEY_ID_MAX + 1])   )
 		{
 			// At least one of the allocations failed.
 			// Keep all 4 objects in sync with one another (i.e. either all allocated, or all not allocated):
@@ -3640,8 +3740,20 @@ void ChangeHookState(Hotkey *aHK[], int aHK_count, HookType aWhichHook, HookType
 		kvk[VK_SCROLL].pForceToggle = &g_ForceScrollLock;
 		kvk[VK_CAPITAL].pForceToggle = &g_ForceCapsLock;
 		kvk[VK_NUMLOCK].pForceToggle = &g_ForceNumLock;
+
+		// hotkey_up[] is large enough for every possible hotkey ID, so it never has to be reallocated
+		// while the hook thread might be using it.  Entries beyond aHK_count are never written until
+		// the corresponding hotkeys are created, so only the first aHK_count need to be reset below:
+		for (int hk_id = 0; hk_id <= HOTKEY_ID_MAX; ++hk_id)
+			hotkey_up[hk_id] = HOTKEY_ID_INVALID;
 	}
 
+	// Sized according to the actual number of hotkeys, which is no longer subject to a fixed maximum.
+	// Allocate it prior to changing anything so that failure leaves the existing configuration intact:
+	hk_sorted_type *hk_sorted = (hk_sorted_type *)malloc(aHK_count * sizeof(hk_sorted_type) + 1); // +1 avoids a zero-size request.
+	if (!hk_sorted)
+		return;
+
 	// Init only those attributes which reflect the hotkey's definition, not those that reflect
 	// the key's current status (since those are intialized only if the hook state is changing
 	// from OFF to ON (later below):
@@ -3662,11 +3774,10 @@ void ChangeHookState(Hotkey *aHK[], int aHK_count, HookType aWhichHook, HookType
 		kvkm[i] = HOTKEY_ID_INVALID;
 	for (i = 0; i < KSCM_SIZE; ++i) // Simplify by viewing 2-dimensional array as a 1-dimensional array.
 		kscm[i] = HOTKEY_ID_INVALID;
-	for (i = 0; i < MAX_HOTKEYS; ++i)
+	for (i = 0; i < aHK_count; ++i)
 		hotkey_up[i] = HOTKEY_ID_INVALID;
 
-	hk_sorted_type hk_sorted[MAX_HOTKEYS];
-	ZeroMemory(hk_sorted, sizeof(hk_sorted));
+	ZeroMemory(hk_sorted, aHK_count * sizeof(hk_sorted_type));
 	int hk_sorted_count = 0;
 	key_type *pThisKey = NULL;
 	for (i = 0; i < aHK_count; ++i)
@@ -4004,6 +4115,8 @@ void ChangeHookState(Hotkey *aHK[], int aHK_count, HookType aWhichHook, HookType
 		}
 	}
 
+	free(hk_sorted);
+
 	// Add or remove hooks, as needed.  No change is made if the hooks are already in the correct state.
 	AddRemoveHooks(hooks_to_be_active);
 }
@@ -4511,6 +4624,36 @@ void ResetKeyTypeState(key_type &key)
 
 
 
+void GetHookLatency(char *aBuf, int aBufSize)
+// Appends a summary of g_HookStats to aBuf.
+// aBufSize is an int so that any negative values passed in from caller are not lost.
+{
+	int h, i;
+	for (h = 0; h < 2; ++h)
+	{
+		if (!g_HookStats.passed[h] && !g_HookStats.suppressed[h]) // This hook hasn't seen any events.
+			continue;
+		snprintfcat(aBuf, aBufSize, "\r\n%s hook events: %u passed, %u suppressed.  Microseconds (count):"
+			, h ? "Mouse" : "Keybd", g_HookStats.passed[h], g_HookStats.suppressed[h]);
+		for (i = 0; i < HOOK_LATENCY_BUCKETS; ++i)
+			if (g_HookStats.histogram[h][i])
+				snprintfcat(aBuf, aBufSize, i < HOOK_LATENCY_BUCKETS - 1 ? " <%u (%u)" : " >=%u (%u)"
+					, i < HOOK_LATENCY_BUCKETS - 1 ? 1UL << i : 1UL << (i - 1), g_HookStats.histogram[h][i]);
+	}
+	if (!g_HookStats.slowest[0].microseconds) // No events have been timed.
+		return;
+	snprintfcat(aBuf, aBufSize, "\r\nSlowest hook events (microseconds, VK, SC, Up/Dn, hotkey ID):");
+	for (i = 0; i < HOOK_SLOWEST_EVENTS && g_HookStats.slowest[i].microseconds; ++i)
+	{
+		HookSlowEvent &item = g_HookStats.slowest[i];
+		snprintfcat(aBuf, aBufSize, item.hotkey_id == HOTKEY_ID_INVALID ? "\r\n%u\t%02X  %03X\t%c" : "\r\n%u\t%02X  %03X\t%c\t%u"
+			, item.microseconds, item.vk, item.sc, item.key_up ? 'u' : 'd', item.hotkey_id & HOTKEY_ID_MASK);
+	}
+	snprintfcat(aBuf, aBufSize, "\r\n");
+}
+
+
+
 void GetHookStatus(char *aBuf, int aBufSize)
 // aBufSize is an int so that any negative values passed in from caller are not lost.
 {
@@ -4522,6 +4665,7 @@ void GetHookStatus(char *aBuf, int aBufSize)
 		, ModifiersLRToText(g_modifiersLR_logical, LRhText)
 		, ModifiersLRToText(g_modifiersLR_physical, LRpText)
 		, pPrefixKey ? "yes" : "no");
+	GetHookLatency(aBuf, aBufSize);
 
 	if (!g_KeybdHook)
 		snprintfcat(aBuf, aBufSize, "\r\n"
@@ -37,7 +37,8 @@ enum UserMessages {AHK_HOOK_HOTKEY = WM_USER, AHK_HOTSTRING, AHK_USER_MENU, AHK_
 	// with msgs sent by HTML control (AHK_CLIPBOARD_CHANGE) and possibly others (I think WM_USER+100 may be the
 	// start of a range used by other common controls too).  So trying a higher number that's (hopefully) very
 	// unlikely to be used by OS features.
-	, AHK_CLIPBOARD_CHANGE, AHK_HOOK_TEST_MSG, AHK_CHANGE_HOOK_STATE, AHK_GETWINDOWTEXT};
+	, AHK_CLIPBOARD_CHANGE, AHK_HOOK_TEST_MSG, AHK_CHANGE_HOOK_STATE, AHK_GETWINDOWTEXT
+	, AHK_PROFILE_DUMP}; // AHK_PROFILE_DUMP: Writes the /Profile report on demand (see MainWindowProc).
 // NOTE: TRY NEVER TO CHANGE the specific numbers of the above messages, since some users might be
 // using the Post/SendMessage commands to automate AutoHotkey itself.  Here is the original order
 // that should be maintained:
@@ -188,9 +189,12 @@ struct input_type
 	bool EndedBySC;  // Whether the Ending key was one handled by VK or SC.
 	bool EndingRequiredShift;  // Whether the key that terminated the input was one that needed the SHIFT key.
 	char **match; // Array of strings, each string is a match-phrase which if entered, terminates the input.
+	UINT *MatchNext; // Parallel to the above: the next phrase whose last char is the same (see InputIndexMatchList).
 	UINT MatchCount; // The number of strings currently in the array.
-	UINT MatchCountMax; // The maximum number of strings that the match array can contain.
+	UINT MatchCountMax; // The maximum number of strings that the match and MatchNext arrays can contain.
 	#define INPUT_ARRAY_BLOCK_SIZE 1024  // The increment by which the above array expands.
+	#define INPUT_MATCH_NONE UINT_MAX // Terminates the MatchFirstByLastChar chains.
+	UINT MatchFirstByLastChar[256]; // The first phrase ending in a given char (lowercased unless CaseSensitive).
 	char *MatchBuf; // The is the buffer whose contents are pointed to by the match array.
 	UINT MatchBufSize; // The capacity of the above above buffer.
 	bool BackspaceIsUndo;
@@ -203,7 +207,7 @@ struct input_type
 	int BufferLength; // The current length of what the user entered.
 	int BufferLengthMax; // The maximum allowed length of the input.
 	input_type::input_type() // A simple constructor to initialize the fields that need it.
-		: status(INPUT_OFF), match(NULL), MatchBuf(NULL), MatchBufSize(0), buffer(NULL)
+		: status(INPUT_OFF), match(NULL), MatchNext(NULL), MatchBuf(NULL), MatchBufSize(0), buffer(NULL)
 	{}
 };
 
@@ -229,6 +233,29 @@ struct KeyHistoryItem
 	char target_window[KEY_HISTORY_WINDOW_TITLE_SIZE];
 };
 
+// Latency statistics for the hooks.  If a hook takes too long to return, the OS silently removes it
+// (see LowLevelHooksTimeout in MSDN), so these are always collected to help diagnose that.  The cost is
+// two QueryPerformanceCounter() calls per keyboard event or mouse click; mouse movement isn't timed.
+// Only the hook thread writes to these, so no locking is needed.  Readers in other threads (KeyHistory
+// and the /Counters report) might see values that are slightly out of step with each other, which is
+// harmless for display purposes.
+#define HOOK_LATENCY_BUCKETS 16 // Bucket 0 is under 1 microsecond, bucket n (n>0) is 2^(n-1) to 2^n-1, and the last bucket is everything longer.
+#define HOOK_SLOWEST_EVENTS 8
+struct HookSlowEvent
+{
+	DWORD microseconds; // Zero means this slot is unused.
+	HotkeyIDType hotkey_id; // HOTKEY_ID_INVALID if the event didn't trigger a hotkey.
+	vk_type vk;
+	sc_type sc;
+	bool key_up, is_mouse;
+};
+struct HookStats
+{
+	DWORD histogram[2][HOOK_LATENCY_BUCKETS]; // [0] is the keyboard hook and [1] is the mouse hook.
+	DWORD suppressed[2], passed[2]; // Same indexing as above.
+	HookSlowEvent slowest[HOOK_SLOWEST_EVENTS]; // Sorted slowest first.
+};
+
 
 //-------------------------------------------
 
@@ -251,6 +278,8 @@ LRESULT AllowIt(const HHOOK aHook, int aCode, WPARAM wParam, LPARAM lParam, cons
 
 bool CollectInput(KBDLLHOOKSTRUCT &aEvent, const vk_type aVK, const sc_type aSC, bool aKeyUp, bool aIsIgnored
 	, WPARAM &aHotstringWparamToPost, LPARAM &aHotstringLparamToPost);
+void InputIndexMatchList();
+bool InputMatchEndsAt(int aEnd);
 void UpdateKeybdState(KBDLLHOOKSTRUCT &aEvent, const vk_type aVK, const sc_type aSC, bool aKeyUp, bool aIsSuppressed);
 bool KeybdEventIsPhysical(DWORD aEventFlags, const vk_type aVK, bool aKeyUp);
 bool DualStateNumpadKeyIsDown();
@@ -268,5 +297,6 @@ HookType GetActiveHooks();
 void FreeHookMem();
 void ResetKeyTypeState(key_type &key);
 void GetHookStatus(char *aBuf, int aBufSize);
+void GetHookLatency(char *aBuf, int aBufSize);
 
 #endif
@@ -25,7 +25,8 @@ HookType Hotkey::sWhichHookNeeded = 0;
 HookType Hotkey::sWhichHookAlways = 0;
 DWORD Hotkey::sTimePrev = {0};
 DWORD Hotkey::sTimeNow = {0};
-Hotkey *Hotkey::shk[MAX_HOTKEYS] = {NULL};
+Hotkey **Hotkey::shk = NULL;
+HotkeyIDType Hotkey::sHotkeyCountMax = 0;
 HotkeyIDType Hotkey::sNextID = 0;
 const HotkeyIDType &Hotkey::sHotkeyCount = Hotkey::sNextID;
 bool Hotkey::sJoystickHasHotkeys[MAX_JOYSTICKS] = {false};
@@ -33,6 +34,30 @@ DWORD Hotkey::sJoyHotkeyCount = 0;
 
 
 
+// A single keystroke often causes the same criterion to be evaluated several times: by the hook for each
+// variant and prefix key, then again by the main thread when the hotkey message arrives, and once more for
+// each hotstring that has it.  Each evaluation is a window search (WinExist() enumerates every top-level
+// window), so results are cached briefly.  The cache is discarded whenever the foreground window changes,
+// and otherwise after HOT_CRITERION_CACHE_TIMEOUT, which is short enough that changes to titles and to
+// the set of existing windows are seen by the next keystroke typed at a normal pace.
+// Since HotCriterionAllowsFiring() is called by both the hook thread and the main thread, each has its
+// own cache so that no locking is needed.
+#define HOT_CRITERION_CACHE_SIZE 32
+#define HOT_CRITERION_CACHE_TIMEOUT 50 // Milliseconds.
+struct HotCriterionCache
+{
+	struct
+	{
+		char *title, *text; // These identify the criterion, since SetGlobalHotTitleText() gives each unique title+text its own memory.
+		bool is_exist; // #IfWin[Not]Exist vs. #IfWin[Not]Active.
+		HWND found_hwnd; // The result of WinExist() or WinActive().
+	} item[HOT_CRITERION_CACHE_SIZE];
+	int count;
+	HWND fore_win;
+	DWORD tick;
+};
+static HotCriterionCache sHotCriterionCache[2]; // [0] for the main thread and [1] for the hook thread.
+
 HWND HotCriterionAllowsFiring(HotCriterionType aHotCriterion, char *aWinTitle, char *aWinText)
 // This is a global function because it's used by both hotkeys and hotstrings.
 // In addition to being called by the hook thread, this can now be called by the main thread.
@@ -40,20 +65,51 @@ HWND HotCriterionAllowsFiring(HotCriterionType aHotCriterion, char *aWinTitle, c
 // Returns a non-NULL HWND if firing is allowed.  However, if it's a global criterion or
 // a "not-criterion" such as #IfWinNotActive, (HWND)1 is returned rather than a genuine HWND.
 {
-	HWND found_hwnd;
+	bool is_exist;
 	switch(aHotCriterion)
 	{
 	case HOT_IF_ACTIVE:
 	case HOT_IF_NOT_ACTIVE:
-		found_hwnd = WinActive(g_default, aWinTitle, aWinText, "", "", false); // Thread-safe.
+		is_exist = false;
 		break;
 	case HOT_IF_EXIST:
 	case HOT_IF_NOT_EXIST:
-		found_hwnd = WinExist(g_default, aWinTitle, aWinText, "", "", false, false); // Thread-safe.
+		is_exist = true;
 		break;
 	default: // HOT_NO_CRITERION (listed last because most callers avoids calling here by checking this value first).
 		return (HWND)1; // Always allow hotkey to fire.
 	}
+
+	HotCriterionCache &cache = sHotCriterionCache[GetCurrentThreadId() == g_HookThreadID];
+	HWND fore_win = GetForegroundWindow();
+	DWORD tick_now = GetTickCount();
+	if (fore_win != cache.fore_win || tick_now - cache.tick > HOT_CRITERION_CACHE_TIMEOUT)
+	{
+		cache.count = 0; // Discard all results.
+		cache.fore_win = fore_win;
+		cache.tick = tick_now;
+	}
+
+	HWND found_hwnd;
+	int i;
+	for (i = 0; i < cache.count; ++i)
+		if (cache.item[i].title == aWinTitle && cache.item[i].text == aWinText && cache.item[i].is_exist == is_exist)
+			break;
+	if (i < cache.count) // Found in the cache.
+		found_hwnd = cache.item[i].found_hwnd;
+	else
+	{
+		found_hwnd = is_exist ? WinExist(g_default, aWinTitle, aWinText, "", "", false, false) // Thread-safe.
+			: WinActive(g_default, aWinTitle, aWinText, "", "", false); // Thread-safe.
+		if (cache.count < HOT_CRITERION_CACHE_SIZE) // Otherwise, this result isn't cached (the cache will be emptied when it expires).
+		{
+			cache.item[i].title = aWinTitle;
+			cache.item[i].text = aWinText;
+			cache.item[i].is_exist = is_exist;
+			cache.item[i].found_hwnd = found_hwnd;
+			++cache.count;
+		}
+	}
 	return (aHotCriterion == HOT_IF_ACTIVE || aHotCriterion == HOT_IF_EXIST) ? found_hwnd : (HWND)!found_hwnd;
 }
 
@@ -148,7 +204,7 @@ void Hotkey::ManifestAllHotkeysHotstringsHooks()
 	// should have become a hook hotkey due to something learned only later in the second pass.
 	// Doing these types of things in the first pass resolves such situations.
 	bool vk_is_prefix[VK_ARRAY_COUNT] = {false};
-	bool hk_is_inactive[MAX_HOTKEYS]; // No init needed.
+	bool *hk_is_inactive = (bool *)_alloca(sHotkeyCount * sizeof(bool) + 1); // No init needed.  +1 avoids a zero-size request.
 	bool is_win9x = g_os.IsWin9x(); // Might help performance a little by avoiding calls in loops.
 	HotkeyVariant *vp;
 	int i, j;
@@ -1108,20 +1164,46 @@ Hotkey *Hotkey::AddHotkey(Label *aJumpToLabel, HookActionType aHookAction, char
 // Returns the address of the new hotkey on success, or NULL otherwise.
 // The caller is responsible for calling ManifestAllHotkeysHotstringsHooks(), if appropriate.
 {
-	if (   !(shk[sNextID] = new Hotkey(sNextID, aJumpToLabel, aHookAction, aName, aSuffixHasTilde, aUseErrorLevel))   )
+	if (sHotkeyCount >= sHotkeyCountMax && sHotkeyCount <= HOTKEY_ID_MAX) // Otherwise, the constructor reports "max hotkeys".
+	{
+		// Double the size of the array.  Unlike Hotstring::shs, realloc() isn't used because the hook
+		// thread may be reading shk[] (via CriterionAllowsFiring) at this very moment.  Instead, the
+		// contents are copied to a new block and the old block is abandoned rather than freed.  Since
+		// each block is twice the size of the last, the memory wasted this way is less than the final
+		// size of the array, and only a few blocks are ever abandoned:
+		int new_count_max = sHotkeyCountMax ? sHotkeyCountMax * 2 : HOTKEY_BLOCK_SIZE;
+		if (new_count_max > HOTKEY_ID_MAX + 1)
+			new_count_max = HOTKEY_ID_MAX + 1;
+		Hotkey **new_shk = (Hotkey **)malloc(new_count_max * sizeof(Hotkey *));
+		if (!new_shk)
+		{
+			if (aUseErrorLevel)
+				g_ErrorLevel->Assign(HOTKEY_EL_MEM);
+			//else currently a silent failure due to rarity.
+			return NULL;
+		}
+		if (shk)
+			memcpy(new_shk, shk, sHotkeyCount * sizeof(Hotkey *));
+		shk = new_shk;
+		sHotkeyCountMax = (HotkeyIDType)new_count_max;
+	}
+	// Construct into a temp var. rather than directly into shk[] because when the maximum number of
+	// hotkeys has been reached, the constructor fails and there's no room left in the array:
+	Hotkey *hk = new Hotkey(sNextID, aJumpToLabel, aHookAction, aName, aSuffixHasTilde, aUseErrorLevel);
+	if (!hk)
 	{
 		if (aUseErrorLevel)
 			g_ErrorLevel->Assign(HOTKEY_EL_MEM);
 		//else currently a silent failure due to rarity.
 		return NULL;
 	}
-	if (!shk[sNextID]->mConstructedOK)
+	if (!hk->mConstructedOK)
 	{
-		delete shk[sNextID];  // SimpleHeap allows deletion of most recently added item.
+		delete hk;  // SimpleHeap allows deletion of most recently added item.
 		return NULL;  // The constructor already displayed the error (or updated ErrorLevelevel).
 	}
-	++sNextID;
-	return shk[sNextID - 1]; // Indicate success by returning the new hotkey.
+	shk[sNextID++] = hk;
+	return hk; // Indicate success by returning the new hotkey.
 }
 
 
@@ -1159,7 +1241,7 @@ Hotkey::Hotkey(HotkeyIDType aID, Label *aJumpToLabel, HookActionType aHookAction
 // verification of the fact that this hotkey's id is always set equal to it's index in the array
 // (for performance reasons).
 {
-	if (sHotkeyCount >= MAX_HOTKEYS || sNextID > HOTKEY_ID_MAX)  // The latter currently probably can't happen.
+	if (sNextID > HOTKEY_ID_MAX)
 	{
 		// This will actually cause the script to terminate if this hotkey is a static (load-time)
 		// hotkey.  In the future, some other behavior is probably better:
@@ -2183,6 +2265,8 @@ Hotstring **Hotstring::shs = NULL;
 HotstringIDType Hotstring::sHotstringCount = 0;
 HotstringIDType Hotstring::sHotstringCountMax = 0;
 bool Hotstring::mAtLeastOneEnabled = false;
+HotstringIDType Hotstring::sFirstByLastChar[2][256];
+HotstringIDType Hotstring::sLastByLastChar[2][256];
 
 
 void Hotstring::SuspendAll(bool aSuspend)
@@ -2344,6 +2428,7 @@ ResultType Hotstring::AddHotstring(Label *aJumpToLabel, char *aOptions, char *aH
 		if (   !(shs = (Hotstring **)malloc(HOTSTRING_BLOCK_SIZE * sizeof(Hotstring *)))   )
 			return g_script.ScriptError(ERR_OUTOFMEM); // Short msg. since so rare.
 		sHotstringCountMax = HOTSTRING_BLOCK_SIZE;
+		memset(sFirstByLastChar, 0xFF, sizeof(sFirstByLastChar)); // Set all to HOTSTRING_ID_NONE (empty chain).
 	}
 	else if (sHotstringCount >= sHotstringCountMax) // Realloc to preserve contents and keep contiguous array.
 	{
@@ -2364,6 +2449,18 @@ ResultType Hotstring::AddHotstring(Label *aJumpToLabel, char *aOptions, char *aH
 		return FAIL;  // The constructor already displayed the error.
 	}
 
+	// Append the new hotstring to the end of its chain.  Since IDs are assigned in ascending order,
+	// this keeps each chain sorted by ID:
+	Hotstring &hs = *shs[sHotstringCount];
+	UCHAR last_char = (UCHAR)(size_t)ltolower(hs.mString[hs.mStringLength - 1]); // Caller has ensured mString isn't blank.
+	HotstringIDType &first = sFirstByLastChar[hs.mEndCharRequired][last_char];
+	hs.mNextWithSameLastChar = HOTSTRING_ID_NONE;
+	if (first == HOTSTRING_ID_NONE)
+		first = sHotstringCount;
+	else
+		shs[sLastByLastChar[hs.mEndCharRequired][last_char]]->mNextWithSameLastChar = sHotstringCount;
+	sLastByLastChar[hs.mEndCharRequired][last_char] = sHotstringCount;
+
 	++sHotstringCount;
 	mAtLeastOneEnabled = true; // Added in v1.0.44.  This method works because the script can't be suspended while hotstrings are being created (upon startup).
 	return OK;
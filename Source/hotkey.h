@@ -21,10 +21,9 @@ GNU General Public License for more details.
 #include "script.h"  // For which label (and in turn which line) in the script to jump to.
 EXTERN_SCRIPT;  // For g_script.
 
-// Due to control/alt/shift modifiers, quite a lot of hotkey combinations are possible, so support any
-// conceivable use.  Note: Increasing this value will increase the memory required (i.e. any arrays
-// that use this value):
-#define MAX_HOTKEYS 1000  // Raised from 700 to 1000 in v1.0.48 because at least one person needed more.
+// Hotkey::shk[] starts at this size and doubles as hotkeys are created, so the number of hotkeys is
+// limited only by HOTKEY_ID_MAX (below) rather than a fixed array size:
+#define HOTKEY_BLOCK_SIZE 256
 
 // Note: 0xBFFF is the largest ID that can be used with RegisterHotkey().
 // But further limit this to 0x3FFF (16,383) so that the two highest order bits
@@ -151,7 +150,8 @@ private:
 	~Hotkey() {if (mIsRegistered) Unregister();}
 
 public:
-	static Hotkey *shk[MAX_HOTKEYS];
+	static Hotkey **shk;
+	static HotkeyIDType sHotkeyCountMax; // Current capacity of shk[].
 	HotkeyIDType mID;  // Must be unique for each hotkey of a given thread.
 	HookActionType mHookAction;
 
@@ -319,6 +319,7 @@ public:
 #define MAX_HOTSTRING_LENGTH_STR "40"  // Keep in sync with the above.
 #define HOTSTRING_BLOCK_SIZE 1024
 typedef UINT HotstringIDType;
+#define HOTSTRING_ID_NONE UINT_MAX // Terminates the sFirstByLastChar chains.  Must be greater than any valid ID (see CollectInput).
 
 enum CaseConformModes {CASE_CONFORM_NONE, CASE_CONFORM_ALL_CAPS, CASE_CONFORM_FIRST_CAP};
 
@@ -330,10 +331,16 @@ public:
 	static HotstringIDType sHotstringCount;
 	static HotstringIDType sHotstringCountMax;
 	static bool mAtLeastOneEnabled; // v1.0.44.08: For performance, such as avoiding calling ToAsciiEx() in the hook.
+	// So that the hook doesn't have to check every hotstring upon every keystroke, hotstrings are also
+	// chained together by the (lowercased) last char of their abbreviation, separately for those that do
+	// and don't require an ending char ([1] and [0] respectively).  Each chain is in ascending order of
+	// ID, which CollectInput() relies upon to preserve the first-defined-wins rule.
+	static HotstringIDType sFirstByLastChar[2][256], sLastByLastChar[2][256];
 
 	Label *mJumpToLabel;
 	char *mString, *mReplacement, *mHotWinTitle, *mHotWinText;
 	int mPriority, mKeyDelay;
+	HotstringIDType mNextWithSameLastChar; // See sFirstByLastChar.
 
 	// Keep members that are smaller than 32-bit adjacent with each other to conserve memory (due to 4-byte alignment).
 	SendModes mSendMode;
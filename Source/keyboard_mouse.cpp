@@ -3676,6 +3676,14 @@ ResultType LayoutHasAltGr(HKL aLayout, ResultType aHasAltGr)
 	// overwrite an arbitrary item in the array.  An LRU/MRU algorithm (timestamp) isn't used because running out
 	// of slots seems too unlikely, and the consequences of running out are merely a slight degradation in performance.
 	CachedLayoutType &cl = sCachedLayout[(i < MAX_CACHED_LAYOUTS) ? i : MAX_CACHED_LAYOUTS-1];
+	// The entry might previously have belonged to another layout whose mod_plus_vk table the main thread
+	// is filling in at this very moment (this function is also called by the hook thread).  So disown it
+	// and clear its table as one step under the same lock CharToVKAndModifiers() uses.  Since hkl is NULL
+	// until it's set to aLayout further below, CharToVKAndModifiers() can't store into the table meanwhile:
+	EnterCriticalSection(&g_CriticalLayoutCache);
+	cl.hkl = NULL;
+	ZeroMemory(cl.mod_plus_vk, sizeof(cl.mod_plus_vk));
+	LeaveCriticalSection(&g_CriticalLayoutCache);
 	if (aHasAltGr != LAYOUT_UNDETERMINED) // Caller determined it for us.  See top of function for explanation.
 	{
 		cl.hkl = aLayout;
@@ -3805,8 +3813,27 @@ vk_type CharToVKAndModifiers(char aChar, modLR_type *pModifiersLR, HKL aKeybdLay
 	if (aChar == '\n')
 		return VK_RETURN;
 
-	// Otherwise:
-	SHORT mod_plus_vk = VkKeyScanEx(aChar, aKeybdLayout); // v1.0.44.03: Benchmark shows that VkKeyScanEx() is the same speed as VkKeyScan() when the layout has been pre-fetched.
+	// Otherwise, look up the character in this layout's cache entry, which is filled in on demand.  The entry
+	// is created by LayoutHasAltGr() if it doesn't exist yet.  Only the main thread sends keystrokes, so only it
+	// fills in mod_plus_vk.  But the hook thread can reuse the entry for another layout via LayoutHasAltGr()
+	// (which requires more than MAX_CACHED_LAYOUTS layouts).  Finding the entry and storing into it are done
+	// under g_CriticalLayoutCache so that this layout's mapping can never be stored into another's table:
+	int i;
+	for (i = 0; i < MAX_CACHED_LAYOUTS && sCachedLayout[i].hkl != aKeybdLayout; ++i);
+	if (i == MAX_CACHED_LAYOUTS)
+		LayoutHasAltGr(aKeybdLayout);
+	EnterCriticalSection(&g_CriticalLayoutCache);
+	for (i = 0; i < MAX_CACHED_LAYOUTS && sCachedLayout[i].hkl != aKeybdLayout; ++i);
+	SHORT mod_plus_vk = 0;
+	if (i < MAX_CACHED_LAYOUTS)
+		mod_plus_vk = sCachedLayout[i].mod_plus_vk[(UCHAR)aChar];
+	if (!mod_plus_vk)
+	{
+		mod_plus_vk = VkKeyScanEx(aChar, aKeybdLayout); // v1.0.44.03: Benchmark shows that VkKeyScanEx() is the same speed as VkKeyScan() when the layout has been pre-fetched.
+		if (i < MAX_CACHED_LAYOUTS)
+			sCachedLayout[i].mod_plus_vk[(UCHAR)aChar] = mod_plus_vk;
+	}
+	LeaveCriticalSection(&g_CriticalLayoutCache);
 	vk_type vk = LOBYTE(mod_plus_vk);
 	char keyscan_modifiers = HIBYTE(mod_plus_vk);
 	if (keyscan_modifiers == -1 && vk == (UCHAR)-1) // No translation could be made.
@@ -175,6 +175,11 @@ struct CachedLayoutType
 {
 	HKL hkl;
 	ResultType has_altgr;
+	// Results of VkKeyScanEx() for this layout, filled in on demand by CharToVKAndModifiers() so that
+	// sending a large amount of text doesn't call it once per character.  An element of zero means "not
+	// yet looked up" (VkKeyScanEx never legitimately returns zero for a character that can be sent, so at
+	// worst such a character is simply looked up each time):
+	SHORT mod_plus_vk[256];
 };
 
 struct key_to_vk_type // Map key names to virtual keys.
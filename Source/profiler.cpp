@@ -0,0 +1,356 @@
+/*
+AutoHotkey
+
+Copyright 2003-2009 Chris Mallett (support@autohotkey.com)
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#include "stdafx.h" // pre-compiled headers
+#include "profiler.h"
+#include "globaldata.h" // for g_script and g_nThreads.
+
+// Static member data:
+char *ScriptProfiler::sOutputFile = NULL;
+DWORD ScriptProfiler::sInterval = PROFILE_DEFAULT_INTERVAL;
+HANDLE ScriptProfiler::sThread = NULL;
+volatile bool ScriptProfiler::sStopRequested = false;
+CRITICAL_SECTION ScriptProfiler::sCritical; // Initialized by Start().
+ProfileSample *ScriptProfiler::sSample = NULL;
+UINT ScriptProfiler::sSampleCount = 0;
+UINT ScriptProfiler::sSampleCountMax = 0;
+
+#define PROFILE_INITIAL_TABLE_SIZE 4096 // Must be a power of two.  Enough for most scripts without ever expanding.
+#define PROFILE_HASH(line, func, label) ((UINT)(((UINT_PTR)(line) >> 2) * 2654435761U \
+	^ ((UINT_PTR)(func) >> 2) * 40503U ^ ((UINT_PTR)(label) >> 2)))
+
+
+
+ResultType ScriptProfiler::Start()
+// Caller must have called SetOutputFile().  Returns FAIL if the sampler thread couldn't be started,
+// in which case the script simply runs without profiling.
+{
+	if (!sOutputFile || sThread)
+		return FAIL;
+	if (   !(sSample = (ProfileSample *)calloc(PROFILE_INITIAL_TABLE_SIZE, sizeof(ProfileSample)))   )
+		return FAIL;
+	sSampleCountMax = PROFILE_INITIAL_TABLE_SIZE;
+	InitializeCriticalSection(&sCritical);
+	// Improve the resolution of Sleep() in the sampler thread.  This is undone by Stop().
+	timeBeginPeriod(1);
+	DWORD thread_id; // Win9x: Last parameter of CreateThread() cannot be NULL.
+	if (   !(sThread = CreateThread(NULL, 8*1024, SamplerThreadProc, NULL, 0, &thread_id))   )
+	{
+		timeEndPeriod(1);
+		DeleteCriticalSection(&sCritical);
+		free(sSample);
+		sSample = NULL;
+		return FAIL;
+	}
+	// Give the sampler priority over the script's thread so that it wakes up on time even when the
+	// script is CPU-bound:
+	SetThreadPriority(sThread, THREAD_PRIORITY_ABOVE_NORMAL);
+	return OK;
+}
+
+
+
+void ScriptProfiler::Stop()
+// Stops the sampler thread but keeps the collected samples so that WriteReport() can still be called.
+{
+	if (!sThread)
+		return;
+	sStopRequested = true;
+	// The thread should notice the flag within one interval.  Don't wait forever in case it's
+	// somehow hung, since this is called during program exit:
+	WaitForSingleObject(sThread, 1000);
+	CloseHandle(sThread);
+	sThread = NULL;
+	timeEndPeriod(1);
+}
+
+
+
+DWORD WINAPI ScriptProfiler::SamplerThreadProc(LPVOID aUnused)
+{
+	Line *line;
+	while (!sStopRequested)
+	{
+		Sleep(sInterval);
+		// When no thread is running, the script is idle in its message loop.  mCurrLine would still
+		// point to the last line executed, so record these samples separately rather than charging
+		// them to that line:
+		if (!g_nThreads)
+		{
+			AddSample(NULL, NULL, NULL);
+			continue;
+		}
+		if (   !(line = g_script.mCurrLine)   ) // Fetch only once since the script's thread can change it at any time.
+			continue;
+		AddSample(line, g->CurrentFunc, g->CurrentLabel);
+	}
+	return 0;
+}
+
+
+
+void ScriptProfiler::AddSample(Line *aLine, Func *aFunc, Label *aLabel)
+{
+	EnterCriticalSection(&sCritical);
+	if (sSampleCount >= sSampleCountMax / 2 && !ExpandTable()) // Keep the load factor low so that probes stay short.
+	{
+		LeaveCriticalSection(&sCritical);
+		return; // Out of memory: drop the sample rather than disrupt the script.
+	}
+	UINT mask = sSampleCountMax - 1;
+	UINT i;
+	for (i = PROFILE_HASH(aLine, aFunc, aLabel) & mask; sSample[i].count; i = (i + 1) & mask)
+		if (sSample[i].line == aLine && sSample[i].func == aFunc && sSample[i].label == aLabel)
+			break;
+	if (!sSample[i].count) // A new entry.
+	{
+		sSample[i].line = aLine;
+		sSample[i].func = aFunc;
+		sSample[i].label = aLabel;
+		++sSampleCount;
+	}
+	++sSample[i].count;
+	LeaveCriticalSection(&sCritical);
+}
+
+
+
+bool ScriptProfiler::ExpandTable()
+// Caller must own sCritical.  Doubles the size of the hash table and rehashes all existing entries.
+{
+	UINT new_count_max = sSampleCountMax * 2;
+	ProfileSample *new_sample;
+	if (   !(new_sample = (ProfileSample *)calloc(new_count_max, sizeof(ProfileSample)))   )
+		return false;
+	UINT mask = new_count_max - 1;
+	UINT i, j;
+	for (j = 0; j < sSampleCountMax; ++j)
+	{
+		ProfileSample &s = sSample[j];
+		if (!s.count)
+			continue;
+		for (i = PROFILE_HASH(s.line, s.func, s.label) & mask; new_sample[i].count; i = (i + 1) & mask);
+		new_sample[i] = s;
+	}
+	free(sSample);
+	sSample = new_sample;
+	sSampleCountMax = new_count_max;
+	return true;
+}
+
+
+
+static int ProfileSampleCompare(const void *a1, const void *a2)
+// Sorts samples by descending count so that the hottest stacks are at the top of the report.
+{
+	UINT c1 = (*(ProfileSample **)a1)->count, c2 = (*(ProfileSample **)a2)->count;
+	return c1 > c2 ? -1 : (c1 < c2 ? 1 : 0);
+}
+
+
+
+ResultType ScriptProfiler::WriteReport(char *aFilespec)
+// Writes the samples collected so far in the "collapsed stack" format understood by flamegraph.pl
+// and similar tools.  Each line of the report has the form "label;function;file:line count".
+// The function frame is omitted for lines that aren't inside a function.  Per-function and
+// per-label totals can be obtained by summing (which the flamegraph tools do automatically).
+// This can be called at any time, even while the sampler thread is still running.
+{
+	if (!sSample)
+		return FAIL;
+	if (!aFilespec)
+		aFilespec = sOutputFile;
+	FILE *fp;
+	if (   !(fp = fopen(aFilespec, "w"))   )
+		return FAIL;
+
+	EnterCriticalSection(&sCritical);
+	// Take a snapshot of the non-empty entries so that they can be sorted without disturbing the
+	// hash table (and so that the lock isn't held while writing to the file):
+	ProfileSample *snapshot = (ProfileSample *)malloc(sSampleCount * sizeof(ProfileSample) + 1); // +1 in case sSampleCount is zero.
+	ProfileSample **order = (ProfileSample **)malloc(sSampleCount * sizeof(ProfileSample *) + 1);
+	UINT i, snapshot_count = 0;
+	if (snapshot && order)
+		for (i = 0; i < sSampleCountMax; ++i)
+			if (sSample[i].count)
+			{
+				snapshot[snapshot_count] = sSample[i];
+				order[snapshot_count] = snapshot + snapshot_count;
+				++snapshot_count;
+			}
+	LeaveCriticalSection(&sCritical);
+	if (!snapshot || !order)
+	{
+		free(snapshot); // Safe even if NULL.
+		free(order);
+		fclose(fp);
+		return FAIL;
+	}
+
+	qsort(order, snapshot_count, sizeof(ProfileSample *), ProfileSampleCompare);
+	for (i = 0; i < snapshot_count; ++i)
+	{
+		ProfileSample &s = *order[i];
+		if (!s.line)
+		{
+			fprintf(fp, "(idle) %u\n", s.count);
+			continue;
+		}
+		fprintf(fp, "%s;", s.label ? s.label->mName : "(auto-execute)");
+		if (s.func)
+			fprintf(fp, "%s();", s.func->mName);
+		fprintf(fp, "%s:%u %u\n", Line::sSourceFile[s.line->mFileIndex], s.line->mLineNumber, s.count);
+	}
+	fclose(fp);
+	free(snapshot);
+	free(order);
+	return OK;
+}
+
+
+
+///////////////////////////
+// Instruction Counters //
+///////////////////////////
+
+char *ScriptCounters::sOutputFile = NULL;
+InstructionCounts *ScriptCounters::sCounts = NULL;
+LARGE_INTEGER ScriptCounters::sStartTime, ScriptCounters::sLoadedTime; // Initialized by Start() and LoadFinished().
+
+// Names for the JSON report.  This must be kept in sync with the SymbolType enum in defines.h.
+static char *sSymbolName[SYM_COUNT] = {"STRING", "INTEGER", "FLOAT", "VAR", "OPERAND", "DYNAMIC", "BEGIN"
+	, "POST_INCREMENT", "POST_DECREMENT", "CPAREN", "OPAREN", "COMMA"
+	, "ASSIGN", "ASSIGN_ADD", "ASSIGN_SUBTRACT", "ASSIGN_MULTIPLY", "ASSIGN_DIVIDE", "ASSIGN_FLOORDIVIDE"
+	, "ASSIGN_BITOR", "ASSIGN_BITXOR", "ASSIGN_BITAND", "ASSIGN_BITSHIFTLEFT", "ASSIGN_BITSHIFTRIGHT"
+	, "ASSIGN_CONCAT", "IFF_ELSE", "IFF_THEN", "OR", "AND", "LOWNOT"
+	, "EQUAL", "EQUALCASE", "NOTEQUAL", "GT", "LT", "GTOE", "LTOE", "CONCAT"
+	, "BITOR", "BITXOR", "BITAND", "BITSHIFTLEFT", "BITSHIFTRIGHT"
+	, "ADD", "SUBTRACT", "MULTIPLY", "DIVIDE", "FLOORDIVIDE"
+	, "NEGATIVE", "HIGHNOT", "BITNOT", "ADDRESS", "DEREF", "POWER"
+	, "PRE_INCREMENT", "PRE_DECREMENT", "FUNC"};
+
+
+
+ResultType ScriptCounters::Start(char *aFilespec)
+// Called by WinMain() before the script is loaded, so that everything done by the script (including
+// its auto-execute section) is counted.
+{
+	if (sCounts) // Already started.
+		return OK;
+	if (   !(sCounts = (InstructionCounts *)calloc(1, sizeof(InstructionCounts)))   )
+		return FAIL;
+	sOutputFile = aFilespec;
+	QueryPerformanceCounter(&sStartTime);
+	sLoadedTime = sStartTime; // In case LoadFinished() is never called.
+	return OK;
+}
+
+
+
+ResultType ScriptCounters::WriteReport()
+// Writes all non-zero counters to sOutputFile as a JSON object.  Lines are reported by command name
+// (along with the numeric action type, since some names such as that of ACT_EXPRESSION are blank).
+// The "timing", "memory" and "hook" sections at the end are for benchmarking and should be excluded from any
+// comparison that expects identical results on every run.
+{
+	if (!sCounts)
+		return FAIL;
+	FILE *fp;
+	if (   !(fp = fopen(sOutputFile, "w"))   )
+		return FAIL;
+	InstructionCounts &c = *sCounts;
+	__int64 total;
+	int i;
+	bool first_item;
+
+	fputs("{\n\t\"lines\": {", fp);
+	for (total = 0, first_item = true, i = 0; i < g_ActionCount; ++i)
+	{
+		if (!c.line[i])
+			continue;
+		total += c.line[i];
+		// All command names consist of characters that don't need escaping in JSON:
+		fprintf(fp, "%s\n\t\t\"%d %s\": %I64d", first_item ? "" : ",", i, g_act[i].Name, c.line[i]);
+		first_item = false;
+	}
+	fprintf(fp, "\n\t},\n\t\"lines_total\": %I64d,\n\t\"tokens\": {", total);
+	for (total = 0, first_item = true, i = 0; i < SYM_COUNT; ++i)
+	{
+		if (!c.token[i])
+			continue;
+		total += c.token[i];
+		fprintf(fp, "%s\n\t\t\"%s\": %I64d", first_item ? "" : ",", sSymbolName[i], c.token[i]);
+		first_item = false;
+	}
+	fprintf(fp, "\n\t},\n\t\"tokens_total\": %I64d,\n", total);
+	fprintf(fp, "\t\"var_alloc_simple\": %I64d,\n", c.var_alloc_simple);
+	fprintf(fp, "\t\"var_alloc_malloc\": %I64d,\n", c.var_alloc_malloc);
+	fprintf(fp, "\t\"var_accept_new_mem\": %I64d,\n", c.var_accept_new_mem);
+	fprintf(fp, "\t\"deref_buf_expand\": %I64d,\n", c.deref_buf_expand);
+	fprintf(fp, "\t\"expr_buf_expand\": %I64d,\n", c.expr_buf_expand);
+	fprintf(fp, "\t\"regex_compile\": %I64d,\n", c.regex_compile);
+	fprintf(fp, "\t\"gui_text_set\": %I64d,\n", c.gui_text_set);
+	fprintf(fp, "\t\"gui_text_unchanged\": %I64d,\n", c.gui_text_unchanged);
+
+	// Timing and memory.  These are kept apart from the above because they aren't deterministic.
+	LARGE_INTEGER now, frequency;
+	QueryPerformanceCounter(&now);
+	if (!QueryPerformanceFrequency(&frequency) || !frequency.QuadPart) // No high-resolution counter.
+		frequency.QuadPart = 1; // Avoid division by zero (the reported times will be meaningless).
+	fprintf(fp, "\t\"timing\": {\n\t\t\"load_ms\": %I64d,\n\t\t\"run_ms\": %I64d\n\t},\n"
+		, (sLoadedTime.QuadPart - sStartTime.QuadPart) * 1000 / frequency.QuadPart
+		, (now.QuadPart - sLoadedTime.QuadPart) * 1000 / frequency.QuadPart);
+
+	// GetProcessMemoryInfo() must be loaded dynamically because psapi.dll doesn't exist on Win9x.
+	// The struct below has the same layout as PROCESS_MEMORY_COUNTERS, which is in psapi.h rather than windows.h.
+	struct {DWORD cb, PageFaultCount; SIZE_T PeakWorkingSetSize, WorkingSetSize, QuotaUsage[4]
+		, PagefileUsage, PeakPagefileUsage;} pmc = {0};
+	typedef BOOL (WINAPI *MyGetProcessMemoryInfoType)(HANDLE, void *, DWORD);
+	HINSTANCE hinstLib = LoadLibrary("psapi");
+	MyGetProcessMemoryInfoType lpfnGetProcessMemoryInfo = hinstLib
+		? (MyGetProcessMemoryInfoType)GetProcAddress(hinstLib, "GetProcessMemoryInfo") : NULL;
+	pmc.cb = sizeof(pmc);
+	if (!lpfnGetProcessMemoryInfo || !lpfnGetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)))
+		pmc.PeakWorkingSetSize = pmc.PeakPagefileUsage = 0; // Report zero rather than omitting them, for simplicity.
+	if (hinstLib)
+		FreeLibrary(hinstLib);
+	fprintf(fp, "\t\"memory\": {\n\t\t\"simple_heap_bytes\": %u,\n\t\t\"peak_working_set\": %u,\n"
+		"\t\t\"peak_pagefile_usage\": %u\n\t},\n"
+		, SimpleHeap::GetBlockCount() * BLOCK_SIZE, (UINT)pmc.PeakWorkingSetSize, (UINT)pmc.PeakPagefileUsage);
+
+	// Hook latency (see HookStatsRecord() in hook.cpp).  Bucket n of each histogram counts events that
+	// took less than 2^n microseconds (and at least 2^(n-1)), except the last bucket, which has the rest.
+	fputs("\t\"hook\": {", fp);
+	for (i = 0; i < 2; ++i)
+	{
+		fprintf(fp, "\n\t\t\"%s\": {\"passed\": %u, \"suppressed\": %u, \"histogram_us\": ["
+			, i ? "mouse" : "keybd", g_HookStats.passed[i], g_HookStats.suppressed[i]);
+		for (int bucket = 0; bucket < HOOK_LATENCY_BUCKETS; ++bucket)
+			fprintf(fp, bucket ? ", %u" : "%u", g_HookStats.histogram[i][bucket]);
+		fputs("]},", fp);
+	}
+	fputs("\n\t\t\"slowest\": [", fp);
+	for (i = 0; i < HOOK_SLOWEST_EVENTS && g_HookStats.slowest[i].microseconds; ++i)
+	{
+		HookSlowEvent &item = g_HookStats.slowest[i];
+		fprintf(fp, "%s\n\t\t\t{\"us\": %u, \"vk\": %u, \"sc\": %u, \"up\": %s, \"mouse\": %s, \"hotkey\": %d}"
+			, i ? "," : "", item.microseconds, item.vk, item.sc, item.key_up ? "true" : "false"
+			, item.is_mouse ? "true" : "false", item.hotkey_id == HOTKEY_ID_INVALID ? -1 : (int)(item.hotkey_id & HOTKEY_ID_MASK));
+	}
+	fputs("\n\t\t]\n\t}\n}\n", fp);
+	fclose(fp);
+	return OK;
+}
@@ -0,0 +1,111 @@
+/*
+AutoHotkey
+
+Copyright 2003-2009 Chris Mallett (support@autohotkey.com)
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#ifndef profiler_h
+#define profiler_h
+
+#include "stdafx.h" // pre-compiled headers
+#include "defines.h"
+
+
+// The sampling profiler is enabled via the /Profile command line switch (see WinMain).  When enabled,
+// a background thread wakes up every sInterval milliseconds and records which line the script is
+// currently executing, along with the function and label that line belongs to.  Nothing is added to
+// ExecUntil() or any other part of the script's hot path, so the cost when disabled is zero and the
+// cost when enabled is limited to the sampling thread itself.
+//
+// Reading g_script.mCurrLine and g->CurrentFunc/CurrentLabel from another thread is intentionally
+// unsynchronized.  The worst case is a sample that is attributed to a neighboring line or to the
+// caller of a function that has just returned, which doesn't matter for statistical purposes.
+// All Line/Func/Label objects live in SimpleHeap memory that is never freed, so the pointers can't
+// dangle.
+
+#define PROFILE_DEFAULT_INTERVAL 1 // Milliseconds.  Actual resolution is that of the system timer (see timeBeginPeriod).
+
+class Line;
+class Func;
+class Label;
+
+struct ProfileSample
+{
+	Line *line;   // NULL for samples taken while the script was idle.
+	Func *func;
+	Label *label;
+	UINT count;
+};
+
+class ScriptProfiler
+{
+private:
+	static char *sOutputFile;
+	static DWORD sInterval;
+	static HANDLE sThread;
+	static volatile bool sStopRequested;
+	static CRITICAL_SECTION sCritical;
+
+	static ProfileSample *sSample; // Open-addressing hash table keyed by (line, func, label).
+	static UINT sSampleCount, sSampleCountMax; // sSampleCountMax is always a power of two.
+
+	static DWORD WINAPI SamplerThreadProc(LPVOID aUnused);
+	static void AddSample(Line *aLine, Func *aFunc, Label *aLabel);
+	static bool ExpandTable();
+
+public:
+	static bool IsEnabled() {return sOutputFile != NULL;}
+	static void SetOutputFile(char *aFilespec) {sOutputFile = aFilespec;}
+	static void SetInterval(DWORD aInterval) {sInterval = aInterval ? aInterval : PROFILE_DEFAULT_INTERVAL;}
+	static ResultType Start();
+	static void Stop();
+	static ResultType WriteReport(char *aFilespec = NULL);
+};
+
+
+
+// The instruction counters are enabled via the /Counters command line switch.  Unlike the sampling
+// profiler above, they count events exactly, so the results are the same on every run of a given
+// script regardless of machine speed or load.  This makes them suitable for detecting performance
+// regressions in automated tests.  When disabled, each counting site costs only a NULL check.
+struct InstructionCounts
+{
+	__int64 line[256]; // Lines executed, indexed by ActionTypeType (which is a UCHAR).
+	__int64 token[SYM_COUNT]; // Postfix tokens evaluated by ExpandExpression(), indexed by SymbolType.
+	__int64 var_alloc_simple;   // Var::Assign() had to allocate a new block from SimpleHeap.
+	__int64 var_alloc_malloc;   // Var::Assign() had to malloc() a new (larger) block.
+	__int64 var_accept_new_mem; // Var::AcceptNewMem() took ownership of a caller's block.
+	__int64 deref_buf_expand;   // ExpandArgs() had to enlarge sDerefBuf.
+	__int64 expr_buf_expand;    // ExpandExpression() had to enlarge the deref buffer to fit its result.
+	__int64 regex_compile;      // A RegEx pattern was compiled (i.e. it wasn't found in the cache).
+	__int64 gui_text_set;       // GuiControl changed the text of a Text/Button/GroupBox/etc. control.
+	__int64 gui_text_unchanged; // The same, but the text was already current so no repaint was done.
+};
+
+#define COUNT_EVENT(member) if (ScriptCounters::sCounts) ++ScriptCounters::sCounts->member
+
+class ScriptCounters
+{
+private:
+	static char *sOutputFile;
+	// Unlike the counts, the following vary from run to run.  They're included in the report so that
+	// benchmark scripts can be run from the command line without having to time themselves:
+	static LARGE_INTEGER sStartTime, sLoadedTime;
+public:
+	static InstructionCounts *sCounts; // NULL unless counting is enabled.  Public for COUNT_EVENT().
+	static ResultType Start(char *aFilespec);
+	static void LoadFinished() {if (sCounts) QueryPerformanceCounter(&sLoadedTime);}
+	static ResultType WriteReport();
+};
+
+#endif
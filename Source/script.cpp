@@ -21,6 +21,7 @@ GNU General Public License for more details.
 #include "mt19937ar-cok.h" // for random number generator
 #include "window.h" // for a lot of things
 #include "application.h" // for MsgSleep()
+#include "profiler.h" // for COUNT_EVENT and for writing the profile report upon exit.
 
 // Globals that are for only this module:
 #define MAX_COMMENT_FLAG_LENGTH 15
@@ -43,7 +44,7 @@ Script::Script()
 	, mNextClipboardViewer(NULL), mOnClipboardChangeIsRunning(false), mOnClipboardChangeLabel(NULL)
 	, mOnExitLabel(NULL), mExitReason(EXIT_NONE)
 	, mFirstLabel(NULL), mLastLabel(NULL)
-	, mFirstFunc(NULL), mLastFunc(NULL)
+	, mFunc(NULL), mFuncCount(0), mFuncCountMax(0), mLastFunc(NULL)
 	, mFirstTimer(NULL), mLastTimer(NULL), mTimerEnabledCount(0), mTimerCount(0)
 	, mFirstMenu(NULL), mLastMenu(NULL), mMenuCount(0)
 	, mVar(NULL), mVarCount(0), mVarCountMax(0), mLazyVar(NULL), mLazyVarCount(0)
@@ -208,6 +209,7 @@ Script::~Script() // Destructor.
 #endif
 
 	DeleteCriticalSection(&g_CriticalRegExCache); // g_CriticalRegExCache is used elsewhere for thread-safety.
+	DeleteCriticalSection(&g_CriticalLayoutCache); // Same.
 }
 
 
@@ -861,6 +863,8 @@ void Script::TerminateApp(int aExitCode)
 // Note that g_script's destructor takes care of most other cleanup work, such as destroying
 // tray icons, menus, and unowned windows such as ToolTip.
 {
+	CloseCachedAppendFiles(); // For maintainability, even though the CRT would also close them upon exit.
+	WaitForFileTransfers(); // In case the tray menu was used to exit during a large FileCopy/FileMove.
 	// We call DestroyWindow() because MainWindowProc() has left that up to us.
 	// DestroyWindow() will cause MainWindowProc() to immediately receive and process the
 	// WM_DESTROY msg, which should in turn result in any child windows being destroyed
@@ -870,6 +874,12 @@ void Script::TerminateApp(int aExitCode)
 		g_DestroyWindowCalled = true;
 		DestroyWindow(g_hWnd);
 	}
+	if (ScriptProfiler::IsEnabled())
+	{
+		ScriptProfiler::Stop();
+		ScriptProfiler::WriteReport();
+	}
+	ScriptCounters::WriteReport(); // Does nothing unless the /Counters switch was given.
 	Hotkey::AllDestructAndExit(aExitCode);
 }
 
@@ -1163,7 +1173,7 @@ ResultType Script::LoadIncludedFile(char *aFileSpec, bool aAllowDuplicateInclude
 
 #ifndef AUTOHOTKEYSC
 	// Future: might be best to put a stat() or GetFileAttributes() in here for better handling.
-	FILE *fp = fopen(aFileSpec, "r");
+	FILE *fp = fopen(aFileSpec, "rb");
 	if (!fp)
 	{
 		if (aIgnoreLoadFailure)
@@ -1173,20 +1183,24 @@ ResultType Script::LoadIncludedFile(char *aFileSpec, bool aAllowDuplicateInclude
 		MsgBox(msg_text);
 		return FAIL;
 	}
-	// v1.0.40.11: Otherwise, check if the first three bytes of the file are the UTF-8 BOM marker (and if
-	// so omit them from further consideration).  Apps such as Notepad, WordPad, and Word all insert this
-	// marker if the file is saved in UTF-8 format.  This omits such markers from both the main script and
-	// any files it includes via #Include.
-	// NOTE: To save code size, any UTF-8 BOM bytes at the beginning of a compiled script have already been
-	// stripped out by the script compiler.  Thus, there is no need to check for them in the AUTOHOTKEYSC
-	// section further below.
-	if (fgets(buf, 4, fp)) // Success (the fourth character is the terminator).
+	// Read the entire file into memory so that it can be parsed by the same GetLine() as compiled scripts.
+	// This is much faster for large scripts than one fgets() per line because GetLine() can then find each
+	// end-of-line with memchr() and copy the line with a single memcpy().
+	long file_size;
+	if (fseek(fp, 0, SEEK_END) || (file_size = ftell(fp)) < 0 || fseek(fp, 0, SEEK_SET)
+		|| !(script_buf = (UCHAR *)malloc(file_size + 1))) // +1 so that an empty file still yields a non-NULL buffer.
 	{
-		if (strcmp(buf, "﻿"))  // UTF-8 BOM marker is NOT present.
-			rewind(fp);  // Go back to the beginning so that the first three bytes aren't omitted during loading.
-			// The code size of rewind() has been checked and it seems very tiny.
+		fclose(fp);
+		MsgBox(ERR_OUTOFMEM, 0, aFileSpec);
+		return FAIL;
 	}
-	//else file read error or EOF, let a later section handle it.
+	nDataSize = (ULONG)fread(script_buf, 1, file_size, fp);
+	fclose(fp); // The file isn't needed anymore, which also avoids keeping it open during any nested #Includes.
+	// The file used to be opened in text mode, in which Ctrl+Z is treated as end-of-file.  Preserve that
+	// for backward compatibility:
+	UCHAR *eof_char = (UCHAR *)memchr(script_buf, 26, nDataSize);
+	if (eof_char)
+		nDataSize = (ULONG)(eof_char - script_buf);
 
 	// This is done only after the file has been successfully opened in case aIgnoreLoadFailure==true:
 	if (source_file_index > 0)
@@ -1216,7 +1230,20 @@ ResultType Script::LoadIncludedFile(char *aFileSpec, bool aAllowDuplicateInclude
 		MsgBox("Could not extract script from EXE.", 0, aFileSpec);
 		return FAIL;
 	}
+	HS_EXEArc_Read *fp = &oRead;  // To help consolidate the code below.
+#endif
+
 	UCHAR *script_buf_marker = script_buf;  // "marker" will track where we are in the mem. file as we read from it.
+#ifndef AUTOHOTKEYSC
+	// v1.0.40.11: Check if the first three bytes of the file are the UTF-8 BOM marker (and if so omit
+	// them from further consideration).  Apps such as Notepad, WordPad, and Word all insert this
+	// marker if the file is saved in UTF-8 format.  This omits such markers from both the main script and
+	// any files it includes via #Include.
+	// NOTE: To save code size, any UTF-8 BOM bytes at the beginning of a compiled script have already been
+	// stripped out by the script compiler.  Thus, there is no need to check for them in AUTOHOTKEYSC mode.
+	if (nDataSize >= 3 && !memcmp(script_buf, "\xef\xbb\xbf", 3))
+		script_buf_marker += 3;
+#endif
 
 	// Must cast to int to avoid loss of negative values:
 	#define SCRIPT_BUF_SPACE_REMAINING ((int)(nDataSize - (script_buf_marker - script_buf)))
@@ -1225,8 +1252,6 @@ ResultType Script::LoadIncludedFile(char *aFileSpec, bool aAllowDuplicateInclude
 	// AutoIt3: We have the data in RAW BINARY FORM, the script is a text file, so
 	// this means that instead of a newline character, there may also be carridge
 	// returns 0x0d 0x0a (\r\n)
-	HS_EXEArc_Read *fp = &oRead;  // To help consolidate the code below.
-#endif
 
 	++Line::sSourceFileCount;
 
@@ -1267,16 +1292,15 @@ ResultType Script::LoadIncludedFile(char *aFileSpec, bool aAllowDuplicateInclude
 	// -1 (MAX_UINT in this case) to compensate for the fact that there is a comment containing
 	// the version number added to the top of each compiled script:
 	LineNumberType phys_line_number = -1;
-	// For compiled scripts, limit the number of characters to read to however many remain in the memory
-	// file or the size of the buffer, whichever is less.
+#else
+	LineNumberType phys_line_number = 0;
+#endif
+	// Limit the number of characters to read to however many remain in the memory file or the size
+	// of the buffer, whichever is less.
 	script_buf_space_remaining = SCRIPT_BUF_SPACE_REMAINING;  // Resolve macro only once, for performance.
 	max_chars_to_read = (LINE_SIZE - 1 < script_buf_space_remaining) ? LINE_SIZE - 1
 		: script_buf_space_remaining;
 	buf_length = GetLine(buf, max_chars_to_read, 0, script_buf_marker);
-#else
-	LineNumberType phys_line_number = 0;
-	buf_length = GetLine(buf, LINE_SIZE - 1, 0, fp);
-#endif
 
 	if (in_comment_section = !strncmp(buf, "/*", 2))
 	{
@@ -1314,15 +1338,11 @@ ResultType Script::LoadIncludedFile(char *aFileSpec, bool aAllowDuplicateInclude
 		{
 			// This increment relies on the fact that this loop always has at least one iteration:
 			++phys_line_number; // Tracks phys. line number in *this* file (independent of any recursion caused by #Include).
-#ifdef AUTOHOTKEYSC
 			// See similar section above for comments about the following:
 			script_buf_space_remaining = SCRIPT_BUF_SPACE_REMAINING;  // Resolve macro only once, for performance.
 			max_chars_to_read = (LINE_SIZE - 1 < script_buf_space_remaining) ? LINE_SIZE - 1
 				: script_buf_space_remaining;
 			next_buf_length = GetLine(next_buf, max_chars_to_read, in_continuation_section, script_buf_marker);
-#else
-			next_buf_length = GetLine(next_buf, LINE_SIZE - 1, in_continuation_section, fp);
-#endif
 			if (next_buf_length && next_buf_length != -1) // Prevents infinite loop when file ends with an unclosed "/*" section.  Compare directly to -1 since length is unsigned.
 			{
 				if (in_comment_section) // Look for the uncomment-flag.
@@ -2367,11 +2387,9 @@ continue_main_loop: // This method is used in lieu of "continue" for performance
 		mCombinedLineNumber = saved_line_number;
 	}
 
-#ifdef AUTOHOTKEYSC
 	free(script_buf); // AutoIt3: Close the archive and free the file in memory.
+#ifdef AUTOHOTKEYSC
 	oRead.Close();    //
-#else
-	fclose(fp);
 #endif
 	return OK;
 }
@@ -2387,68 +2405,46 @@ inline ResultType Script::CloseAndReturnFailFunc(HS_EXEArc_Read *fp, UCHAR *aBuf
 	return FAIL;
 }
 #else
-inline ResultType Script::CloseAndReturnFailFunc(FILE *fp)
+inline ResultType Script::CloseAndReturnFailFunc(UCHAR *aBuf)
 {
-	fclose(fp);
+	free(aBuf);
 	return FAIL;
 }
 #endif
 
 
 
-#ifdef AUTOHOTKEYSC
 size_t Script::GetLine(char *aBuf, int aMaxCharsToRead, int aInContinuationSection, UCHAR *&aMemFile) // last param = reference to pointer
-#else
-size_t Script::GetLine(char *aBuf, int aMaxCharsToRead, int aInContinuationSection, FILE *fp)
-#endif
 {
-	size_t aBuf_length = 0;
-#ifdef AUTOHOTKEYSC
+	size_t aBuf_length;
 	if (!aBuf || !aMemFile) return -1;
 	if (aMaxCharsToRead < 1) return -1; // We're signaling to caller that the end of the memory file has been reached.
-	// Otherwise, continue reading characters from the memory file until either a newline is
-	// reached or aMaxCharsToRead have been read:
-	// Track "i" separately from aBuf_length because we want to read beyond the bounds of the memory file.
-	int i;
-	for (i = 0; i < aMaxCharsToRead; ++i)
+	// Otherwise, read characters from the memory file until either a newline is reached or aMaxCharsToRead
+	// have been read.  memchr() is used because it's typically much faster than a char-by-char loop.
+	UCHAR *line_end = (UCHAR *)memchr(aMemFile, '\n', aMaxCharsToRead);
+	if (line_end)
+	{
+		// The end of this line has been reached.  Don't copy the newline char into the target buffer.
+		// In addition, if the previous char was '\r', omit it too:
+		aBuf_length = line_end - aMemFile;
+		memcpy(aBuf, aMemFile, aBuf_length);
+		if (aBuf_length > 0 && aBuf[aBuf_length - 1] == '\r')
+			--aBuf_length;
+		aMemFile = line_end + 1; // Omit the newline char.
+	}
+	else
 	{
-		if (aMemFile[i] == '\n')
-		{
-			// The end of this line has been reached.  Don't copy this char into the target buffer.
-			// In addition, if the previous char was '\r', remove it from the target buffer:
-			if (aBuf_length > 0 && aBuf[aBuf_length - 1] == '\r')
-				aBuf[--aBuf_length] = '\0';
-			++i; // i.e. so that aMemFile will be adjusted to omit this newline char.
-			break;
-		}
-		else
-			aBuf[aBuf_length++] = aMemFile[i];
+		// We read aMaxCharsToRead without finding a newline.  aMemFile might now be changed to be a
+		// position at the end of the memory area, which the caller will reflect back to us during the
+		// next call as a 0 value for aMaxCharsToRead, which we then signal to the caller (above) as the
+		// end of the file:
+		aBuf_length = aMaxCharsToRead;
+		memcpy(aBuf, aMemFile, aBuf_length);
+		aMemFile += aBuf_length;
 	}
-	// We either read aMaxCharsToRead or reached the end of the line (as indicated by the newline char).
-	// In the former case, aMemFile might now be changed to be a position outside the bounds of the
-	// memory area, which the caller will reflect back to us during the next call as a 0 value for
-	// aMaxCharsToRead, which we then signal to the caller (above) as the end of the file):
-	aMemFile += i; // Update this value for use by the caller.
 	// Terminate the buffer (the caller has already ensured that there's room for the terminator
 	// via its value of aMaxCharsToRead):
 	aBuf[aBuf_length] = '\0';
-#else
-	if (!aBuf || !fp) return -1;
-	if (aMaxCharsToRead < 1) return 0;
-	if (feof(fp)) return -1; // Previous call to this function probably already read the last line.
-	if (fgets(aBuf, aMaxCharsToRead, fp) == NULL) // end-of-file or error
-	{
-		*aBuf = '\0';  // Reset since on error, contents added by fgets() are indeterminate.
-		return -1;
-	}
-	aBuf_length = strlen(aBuf);
-	if (!aBuf_length)
-		return 0;
-	if (aBuf[aBuf_length-1] == '\n')
-		aBuf[--aBuf_length] = '\0';
-	if (aBuf[aBuf_length-1] == '\r')  // In case there are any, e.g. a Macintosh or Unix file?
-		aBuf[--aBuf_length] = '\0';
-#endif
 
 	if (aInContinuationSection)
 	{
@@ -2508,7 +2504,10 @@ size_t Script::GetLine(char *aBuf, int aMaxCharsToRead, int aInContinuationSecti
 		// allow these types of comments if the script is considers to be the AutoIt2
 		// style, to improve compatibility with old scripts that may use non-escaped
 		// comment-flags as literal characters rather than comments:
-		char *cp, *prevp;
+		// Escape chars in front of literal comment flags are removed by compacting the line as the loop
+		// goes, so that each char is moved at most once no matter how many escaped flags the line has.
+		// "src" is the start of the part of aBuf that hasn't yet been moved to "dest".
+		char *cp, *prevp, *src, *dest = NULL; // NULL indicates that no escape char has been removed yet.
 		for (cp = strstr(aBuf, g_CommentFlag); cp; cp = strstr(cp + g_CommentFlagLength, g_CommentFlag))
 		{
 			// If no whitespace to its left, it's not a valid comment.
@@ -2522,9 +2521,13 @@ size_t Script::GetLine(char *aBuf, int aMaxCharsToRead, int aInContinuationSecti
 			}
 			if (IS_SPACE_OR_TAB_OR_NBSP(*prevp)) // consider it to be a valid comment flag
 			{
+				if (dest) // Move the part of the line prior to the comment into place.
+				{
+					memmove(dest, src, prevp - src);
+					prevp = dest + (prevp - src);
+				}
 				*prevp = '\0';
-				aBuf_length = rtrim_with_nbsp(aBuf, prevp - aBuf); // Since it's our responsibility to return a fully trimmed string.
-				break; // Once the first valid comment-flag is found, nothing after it can matter.
+				return rtrim_with_nbsp(aBuf, prevp - aBuf); // Since it's our responsibility to return a fully trimmed string.  Once the first valid comment-flag is found, nothing after it can matter.
 			}
 			else // No whitespace to the left.
 				if (*prevp == g_EscapeChar) // Remove the escape char.
@@ -2535,13 +2538,22 @@ size_t Script::GetLine(char *aBuf, int aMaxCharsToRead, int aInContinuationSecti
 					// it would probably break existing scripts that rely on the fact that accents do not need
 					// to be escaped inside #Include.  Also, the likelihood of "`;" appearing literally in a
 					// legitimate #Include file seems vanishingly small.
-					memmove(prevp, prevp + 1, strlen(prevp + 1) + 1);  // +1 for the terminator.
+					if (dest)
+					{
+						memmove(dest, src, prevp - src);
+						dest += prevp - src;
+					}
+					else // This is the first escape char to be removed, so everything to its left is already in place.
+						dest = prevp;
+					src = cp; // Omit the escape char itself.
 					--aBuf_length;
 					// Then continue looking for others.
 				}
 				// else there wasn't any whitespace to its left, so keep looking in case there's
 				// another further on in the line.
 		} // for()
+		if (dest) // Move the remainder of the line (including its terminator) into place.
+			memmove(dest, src, strlen(src) + 1);
 	} // if (g_AllowSameLineComments)
 
 	return aBuf_length; // The above is responsible for keeping aBufLength up-to-date with any changes to aBuf.
@@ -6540,7 +6552,8 @@ ResultType Script::DefineFunc(char *aBuf, Var *aFuncExceptionVar[])
 {
 	char *param_end, *param_start = strchr(aBuf, '('); // Caller has ensured that this will return non-NULL.
 
-	Func *found_func = FindFunc(aBuf, param_start - aBuf);
+	int insert_pos;
+	Func *found_func = FindFunc(aBuf, param_start - aBuf, &insert_pos);
 	if (found_func)
 	{
 		if (!found_func->mIsBuiltIn)
@@ -6557,12 +6570,11 @@ ResultType Script::DefineFunc(char *aBuf, Var *aFuncExceptionVar[])
 	else
 		// The value of g->CurrentFunc must be set here rather than by our caller since AddVar(), which we call,
 		// relies upon it having been done.
-		if (   !(g->CurrentFunc = AddFunc(aBuf, param_start - aBuf, false))   )
+		if (   !(g->CurrentFunc = AddFunc(aBuf, param_start - aBuf, false, insert_pos))   )
 			return FAIL; // It already displayed the error.
 
 	mCurrentFuncOpenBlockCount = 0; // v1.0.48.01: Initializing this here makes function definions work properly when they're inside a block.
 	Func &func = *g->CurrentFunc; // For performance and convenience.
-	int insert_pos;
 	size_t param_length, value_length;
 	FuncParam param[MAX_FUNCTION_PARAMS];
 	int param_count = 0;
@@ -6889,10 +6901,15 @@ Func *Script::FindFuncInLibrary(char *aFuncName, size_t aFuncNameLength, bool &a
 
 
 
-Func *Script::FindFunc(char *aFuncName, size_t aFuncNameLength)
+Func *Script::FindFunc(char *aFuncName, size_t aFuncNameLength, int *apInsertPos)
 // Returns the Function whose name matches aFuncName (which caller has ensured isn't NULL).
 // If it doesn't exist, NULL is returned.
+// If caller provided a non-NULL apInsertPos, it will be given the array index that a newly added
+// function should have to keep mFunc in sorted order (see AddFunc).  Like FindVar(), caller must
+// ignore the contents of apInsertPos when a match is returned.
 {
+	if (apInsertPos) // Set default.
+		*apInsertPos = -1;
 	if (!aFuncNameLength) // Caller didn't specify, so use the entire string.
 		aFuncNameLength = strlen(aFuncName);
 
@@ -6908,13 +6925,26 @@ Func *Script::FindFunc(char *aFuncName, size_t aFuncNameLength)
 	char func_name[MAX_VAR_NAME_LENGTH + 1];
 	strlcpy(func_name, aFuncName, aFuncNameLength + 1);  // +1 to convert length to size.
 
-	Func *pfunc;
-	for (pfunc = mFirstFunc; pfunc; pfunc = pfunc->mNextFunc)
-		if (!stricmp(func_name, pfunc->mName)) // lstrcmpi() is not used: 1) avoids breaking exisitng scripts; 2) provides consistent behavior across multiple locales; 3) performance.
-			return pfunc; // Match found.
+	// Binary search.  This used to be a linear search of a linked list, which made the load-time
+	// resolution of function calls (see PreparseBlocks) O(calls*functions) for large scripts.
+	int left, right, mid, result;  // left/right must be ints to allow them to go negative and detect underflow.
+	for (left = 0, right = mFuncCount - 1; left <= right;)
+	{
+		mid = (left + right) / 2;
+		result = stricmp(func_name, mFunc[mid]->mName); // lstrcmpi() is not used: 1) avoids breaking exisitng scripts; 2) provides consistent behavior across multiple locales; 3) performance.
+		if (result > 0)
+			left = mid + 1;
+		else if (result < 0)
+			right = mid - 1;
+		else // Match found.
+			return mFunc[mid];
+	}
+	if (apInsertPos)
+		*apInsertPos = left;
 
 	// Since above didn't return, there is no match.  See if it's a built-in function that hasn't yet
 	// been added to the function list.
+	Func *pfunc;
 
 	// Set defaults to be possibly overridden below:
 	int min_params = 1;
@@ -7186,7 +7216,7 @@ Func *Script::FindFunc(char *aFuncName, size_t aFuncNameLength)
 
 	// Since above didn't return, this is a built-in function that hasn't yet been added to the list.
 	// Add it now:
-	if (   !(pfunc = AddFunc(func_name, aFuncNameLength, true))   )
+	if (   !(pfunc = AddFunc(func_name, aFuncNameLength, true, left))   ) // "left" is the insertion point determined by the search above.
 		return NULL;
 
 	pfunc->mBIF = bif;
@@ -7198,11 +7228,12 @@ Func *Script::FindFunc(char *aFuncName, size_t aFuncNameLength)
 
 
 
-Func *Script::AddFunc(char *aFuncName, size_t aFuncNameLength, bool aIsBuiltIn)
+Func *Script::AddFunc(char *aFuncName, size_t aFuncNameLength, bool aIsBuiltIn, int aInsertPos)
 // This function should probably not be called by anyone except FindOrAddFunc, which has already done
 // the dupe-checking.
 // Returns the address of the new function or NULL on failure.
-// The caller must already have verified that this isn't a duplicate function.
+// The caller must already have verified that this isn't a duplicate function, and aInsertPos must be
+// the insertion point reported by FindFunc() for this name.
 {
 	if (!aFuncNameLength) // Caller didn't specify, so use the entire string.
 		aFuncNameLength = strlen(aFuncName);
@@ -7251,21 +7282,26 @@ Func *Script::AddFunc(char *aFuncName, size_t aFuncNameLength, bool aIsBuiltIn)
 		return NULL;
 	}
 
-	// v1.0.47: The following ISN'T done because it would slow down commonly used functions. This is because
-	// commonly-called functions like InStr() tend to be added first (since they appear so often throughout
-	// the script); thus subsequent lookups are fast if they are kept at the beginning of the list rather
-	// than being displaced to the end by all other functions).
-	// NOT DONE for the reason above:
-	// Unlike most of the other link lists, attach new items at the beginning of the list because
-	// that allows the standard/user library feature to perform much better for scripts that have hundreds
-	// of functions.  This is because functions brought in dynamically from a library will then be at the
-	// beginning of the list, which allows the function lookup that immediately follows library-loading to
-	// find a match almost immediately.
-	if (!mFirstFunc) // The list is empty, so this will be the first and last item.
-		mFirstFunc = the_new_func;
-	else
-		mLastFunc->mNextFunc = the_new_func;
-	// This must be done after the above:
+	if (mFuncCount == mFuncCountMax)
+	{
+		// Grow in large steps for the same reason as AddVar(): realloc() is relatively expensive, and even
+		// scripts with thousands of functions only need a few KB for this array.
+		int alloc_count = mFuncCountMax ? mFuncCountMax * 2 : 256; // 256 covers the built-in functions plus a typical script.
+		Func **temp = (Func **)realloc(mFunc, alloc_count * sizeof(Func *)); // If passed NULL, realloc() will do a malloc().
+		if (!temp)
+		{
+			ScriptError(ERR_OUTOFMEM);
+			return NULL;
+		}
+		mFunc = temp;
+		mFuncCountMax = alloc_count;
+	}
+	if (aInsertPos != mFuncCount) // Need to make room at the indicated position for this function.
+		memmove(mFunc + aInsertPos + 1, mFunc + aInsertPos, (mFuncCount - aInsertPos) * sizeof(Func *));
+	//else both are zero or the item is being inserted at the end of the list, so it's easy.
+	mFunc[aInsertPos] = the_new_func;
+	++mFuncCount;
+
 	mLastFunc = the_new_func; // There's at least one spot in the code that relies on mLastFunc being the most recently added function.
 
 	return the_new_func;
@@ -10007,6 +10043,7 @@ ResultType Line::ExecUntil(ExecUntilMode aMode, char **apReturnValue, Line **apJ
 		// of time doing what it needed to do.  i.e. do these immediately before the line will actually
 		// be run so that the time it takes to run will be reflected in the ListLines log.
         g_script.mCurrLine = line;  // Simplifies error reporting when we get deep into function calls.
+		COUNT_EVENT(line[line->mActionType]);
 
 		if (g.ListLinesIsEnabled)
 		{
@@ -12734,6 +12771,7 @@ __forceinline ResultType Line::Perform() // As of 2/9/2009, __forceinline() redu
 			// complete if the source directory is in use (due to being a working dir for a currently
 			// running process, or containing a file that is being written to).  In other words,
 			// the operation will be "all or none":
+			CloseCachedAppendFiles(); // Otherwise, a file FileAppend is keeping open inside the folder would prevent the rename.
 			g_ErrorLevel->Assign(MoveFile(ARG1, ARG2) ? ERRORLEVEL_NONE : ERRORLEVEL_ERROR);
 			return OK;
 		}
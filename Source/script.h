@@ -1862,7 +1862,6 @@ public:
 	Var **mVar, **mLazyVar; // Array of pointers-to-variable, allocated upon first use and later expanded as needed.
 	int mVarCount, mVarCountMax, mLazyVarCount; // Count of items in the above array as well as the maximum capacity.
 	int mInstances; // How many instances currently exist on the call stack (due to recursion or thread interruption).  Future use: Might be used to limit how deep recursion can go to help prevent stack overflow.
-	Func *mNextFunc; // Next item in linked list.
 
 	// Keep small members adjacent to each other to save space and improve perf. due to byte alignment:
 	UCHAR mDefaultVarType;
@@ -1922,7 +1921,7 @@ public:
 		, mBIF(NULL)
 		, mParam(NULL), mParamCount(0), mMinParams(0)
 		, mVar(NULL), mVarCount(0), mVarCountMax(0), mLazyVar(NULL), mLazyVarCount(0)
-		, mInstances(0), mNextFunc(NULL)
+		, mInstances(0)
 		, mDefaultVarType(VAR_DECLARE_NONE)
 		, mIsBuiltIn(aIsBuiltIn)
 	{}
@@ -2088,6 +2087,7 @@ struct lv_attrib_type
 	lv_col_type col[LV_MAX_COLUMNS];
 	int col_count; // Number of columns currently in the above array.
 	int row_count_hint;
+	#define LV_AUTO_GROW_MIN_ROWS 1024 // See BIF_LV_AddInsertModify().
 };
 
 typedef UCHAR TabControlIndexType;
@@ -2183,6 +2183,8 @@ public:
 	GuiIndexType mControlCount;
 	GuiIndexType mControlCapacity; // How many controls can fit into the current memory size of mControl.
 	GuiControlType *mControl; // Will become an array of controls when the window is first created.
+	GuiIndexType *mControlByVar; // Hash table of control indices keyed by output_var (see FindControlByVar).  NULL when out of date.
+	GuiIndexType mControlByVarMask; // Size of the above minus one (the size is always a power of two).
 	GuiIndexType mDefaultButtonIndex; // Index vs. pointer is needed for some things.
 	Label *mLabelForClose, *mLabelForEscape, *mLabelForSize, *mLabelForDropFiles, *mLabelForContextMenu;
 	bool mLabelForCloseIsRunning, mLabelForEscapeIsRunning, mLabelForSizeIsRunning; // DropFiles doesn't need one of these.
@@ -2224,6 +2226,7 @@ public:
 
 	GuiType(int aWindowIndex) // Constructor
 		: mHwnd(NULL), mStatusBarHwnd(NULL), mWindowIndex(aWindowIndex), mControlCount(0), mControlCapacity(0)
+		, mControlByVar(NULL), mControlByVarMask(0)
 		, mDefaultButtonIndex(-1), mLabelForClose(NULL), mLabelForEscape(NULL), mLabelForSize(NULL)
 		, mLabelForDropFiles(NULL), mLabelForContextMenu(NULL)
 		, mLabelForCloseIsRunning(false), mLabelForEscapeIsRunning(false), mLabelForSizeIsRunning(false)
@@ -2309,6 +2312,9 @@ public:
 
 
 	GuiIndexType FindControl(char *aControlID);
+	GuiIndexType FindControlByVar(Var *aVar);
+	// Must be called whenever a control is added or a control's output_var changes:
+	void ControlVarsChanged() {free(mControlByVar); mControlByVar = NULL;}
 	GuiControlType *FindControl(HWND aHwnd, bool aRetrieveIndexInstead = false)
 	{
 		GuiIndexType index = GUI_HWND_TO_INDEX(aHwnd); // Retrieves a small negative on failure, which will be out of bounds when converted to unsigned.
@@ -2367,7 +2373,9 @@ private:
 	Line *mFirstLine, *mLastLine;     // The first and last lines in the linked list.
 	UINT mLineCount;                  // The number of lines.
 	Label *mFirstLabel, *mLastLabel;  // The first and last labels in the linked list.
-	Func *mFirstFunc, *mLastFunc;     // The first and last functions in the linked list.
+	Func **mFunc; // Array of pointers-to-function, kept sorted by name so that FindFunc() can use a binary search.
+	int mFuncCount, mFuncCountMax; // Count of items in the above array as well as the maximum capacity.
+	Func *mLastFunc; // The most recently added function.
 	Var **mVar, **mLazyVar; // Array of pointers-to-variable, allocated upon first use and later expanded as needed.
 	int mVarCount, mVarCountMax, mLazyVarCount; // Count of items in the above array as well as the maximum capacity.
 	WinGroup *mFirstGroup, *mLastGroup;  // The first and last variables in the linked list.
@@ -2393,12 +2401,11 @@ private:
 #ifdef AUTOHOTKEYSC
 	#define CloseAndReturnFail(fp, aBuf) CloseAndReturnFailFunc(fp, aBuf)
 	ResultType CloseAndReturnFailFunc(HS_EXEArc_Read *fp, UCHAR *aBuf);
-	size_t GetLine(char *aBuf, int aMaxCharsToRead, int aInContinuationSection, UCHAR *&aMemFile);
 #else
-	#define CloseAndReturnFail(fp, aBuf) CloseAndReturnFailFunc(fp)
-	ResultType CloseAndReturnFailFunc(FILE *fp);
-	size_t GetLine(char *aBuf, int aMaxCharsToRead, int aInContinuationSection, FILE *fp);
+	#define CloseAndReturnFail(fp, aBuf) CloseAndReturnFailFunc(aBuf) // There's no open file because it was read into aBuf in its entirety.
+	ResultType CloseAndReturnFailFunc(UCHAR *aBuf);
 #endif
+	size_t GetLine(char *aBuf, int aMaxCharsToRead, int aInContinuationSection, UCHAR *&aMemFile);
 	ResultType IsDirective(char *aBuf);
 
 	ResultType ParseAndAddLine(char *aLineText, ActionTypeType aActionType = ACT_INVALID
@@ -2496,8 +2503,8 @@ public:
 #ifndef AUTOHOTKEYSC
 	Func *FindFuncInLibrary(char *aFuncName, size_t aFuncNameLength, bool &aErrorWasShown);
 #endif
-	Func *FindFunc(char *aFuncName, size_t aFuncNameLength = 0);
-	Func *AddFunc(char *aFuncName, size_t aFuncNameLength, bool aIsBuiltIn);
+	Func *FindFunc(char *aFuncName, size_t aFuncNameLength = 0, int *apInsertPos = NULL);
+	Func *AddFunc(char *aFuncName, size_t aFuncNameLength, bool aIsBuiltIn, int aInsertPos);
 
 	#define ALWAYS_USE_DEFAULT  0
 	#define ALWAYS_USE_GLOBAL   1
@@ -2721,8 +2728,18 @@ double TokenToDouble(ExprTokenType &aToken, BOOL aCheckForHex = TRUE, BOOL aIsPu
 char *TokenToString(ExprTokenType &aToken, char *aBuf = NULL);
 ResultType TokenToDoubleOrInt64(ExprTokenType &aToken);
 
+struct real_pcre; // Same as in pcre.h, so that callers outside script2.cpp can hold a compiled RegEx.
+typedef struct real_pcre pcre;
+struct pcre_extra;
+pcre *get_compiled_regex(char *aRegEx, bool &aGetPositionsNotSubstrings, pcre_extra *&aExtra, ExprTokenType *aResultToken, bool aPin = false);
+void release_compiled_regex(pcre *aRE);
 char *RegExMatch(char *aHaystack, char *aNeedleRegEx);
+char *RegExMatch(char *aHaystack, pcre *aRE, pcre_extra *aExtra);
 void SetWorkingDir(char *aNewDir);
+#define FILE_APPEND_CACHE_TIMEOUT 1000 // Milliseconds a file may go unused before FileAppend's cache closes it.
+void CloseCachedAppendFiles(char *aFilespec = NULL, DWORD aMinIdleTime = 0);
+void WaitForFileTransfers();
+void FreeScreenCapture();
 int ConvertJoy(char *aBuf, int *aJoystickID = NULL, bool aAllowOnlyButtons = false);
 bool ScriptGetKeyState(vk_type aVK, KeyStateTypes aKeyStateType);
 double ScriptGetJoyState(JoyControls aJoy, int aJoystickID, ExprTokenType &aToken, bool aUseBoolForUpDown);
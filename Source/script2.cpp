@@ -23,6 +23,7 @@ GNU General Public License for more details.
 #include "window.h" // for IF_USE_FOREGROUND_WINDOW
 #include "application.h" // for MsgSleep()
 #include "resources\resource.h"  // For InputBox.
+#include "profiler.h" // For AHK_PROFILE_DUMP and COUNT_EVENT.
 
 #define PCRE_STATIC             // For RegEx. PCRE_STATIC tells PCRE to declare its functions for normal, static
 #include "lib_pcre/pcre/pcre.h" // linkage rather than as functions inside an external DLL.
@@ -1372,14 +1373,20 @@ ResultType Line::Input()
 	// Parse aMatchList into an array of key phrases:
 	/////////////////////////////////////////////////
 	char **realloc_temp;  // Needed since realloc returns NULL on failure but leaves original block allocated.
+	UINT *realloc_next_temp; //
 	g_input.MatchCount = 0;  // Set default.
 	if (*aMatchList)
 	{
 		// If needed, create the array of pointers that points into MatchBuf to each match phrase:
 		if (!g_input.match)
 		{
-			if (   !(g_input.match = (char **)malloc(INPUT_ARRAY_BLOCK_SIZE * sizeof(char *)))   )
+			if (   !(g_input.match = (char **)malloc(INPUT_ARRAY_BLOCK_SIZE * sizeof(char *)))
+				|| !(g_input.MatchNext = (UINT *)malloc(INPUT_ARRAY_BLOCK_SIZE * sizeof(UINT)))   )
+			{
+				free(g_input.match); // In case only the second allocation failed.
+				g_input.match = NULL;
 				return LineError(ERR_OUTOFMEM);  // Short msg. since so rare.
+			}
 			g_input.MatchCountMax = INPUT_ARRAY_BLOCK_SIZE;
 		}
 		// If needed, create or enlarge the buffer that contains all the match phrases:
@@ -1430,11 +1437,15 @@ ResultType Line::Input()
 			{
 				if (g_input.MatchCount >= g_input.MatchCountMax) // Rarely needed, so just realloc() to expand.
 				{
-					// Expand the array by one block:
+					// Expand the arrays by one block:
 					if (   !(realloc_temp = (char **)realloc(g_input.match  // Must use a temp variable.
 						, (g_input.MatchCountMax + INPUT_ARRAY_BLOCK_SIZE) * sizeof(char *)))   )
 						return LineError(ERR_OUTOFMEM);  // Short msg. since so rare.
 					g_input.match = realloc_temp;
+					if (   !(realloc_next_temp = (UINT *)realloc(g_input.MatchNext
+						, (g_input.MatchCountMax + INPUT_ARRAY_BLOCK_SIZE) * sizeof(UINT)))   )
+						return LineError(ERR_OUTOFMEM);  // Short msg. since so rare.  MatchCountMax isn't increased, so both arrays remain usable at their old size.
+					g_input.MatchNext = realloc_next_temp;
 					g_input.MatchCountMax += INPUT_ARRAY_BLOCK_SIZE;
 				}
 			}
@@ -1530,6 +1541,8 @@ ResultType Line::Input()
 	// Point the global addresses to our memory areas on the stack:
 	g_input.EndVK = end_vk;
 	g_input.EndSC = end_sc;
+	if (g_input.MatchCount) // Must be done after the options are parsed since it depends on CaseSensitive.
+		InputIndexMatchList();
 	g_input.status = INPUT_IN_PROGRESS; // Signal the hook to start the input.
 
 	// Make script persistent.  This is mostly for backward compatibility because it is documented behavior.
@@ -3704,51 +3717,32 @@ ResultType Line::WinGetText(char *aTitle, char *aText, char *aExcludeTitle, char
 	if (!target_window)
 		return output_var.Assign(); // Tell it not to free the memory by not calling with "".
 
+	// Collect the text of all the controls in a single pass, growing the buffer as needed.  This avoids
+	// sending every control WM_GETTEXTLENGTH twice, and means that a control that fails to respond costs
+	// at most one timeout rather than one in each of two passes.  In addition, the total time spent is
+	// limited by WINGETTEXT_TOTAL_TIMEOUT so that several slow controls can't stall the script indefinitely:
 	length_and_buf_type sab;
-	sab.buf = NULL; // Tell it just to calculate the length this time around.
-	sab.total_length = 0; // Init
-	sab.capacity = 0;     //
+	sab.buf = NULL;
+	sab.total_length = 0;
+	sab.capacity = 0;
+	sab.deadline = GetTickCount() + WINGETTEXT_TOTAL_TIMEOUT;
+	sab.truncated = false;
 	EnumChildWindows(target_window, EnumChildGetText, (LPARAM)&sab);
 
-	if (!sab.total_length) // No text in window.
-	{
-		g_ErrorLevel->Assign(ERRORLEVEL_NONE); // Indicate success.
-		return output_var.Assign(); // Tell it not to free the memory by omitting all params.
-	}
 	// This adjustment was added because someone reported that max variable capacity was being
 	// exceeded in some cases (perhaps custom controls that retrieve large amounts of text
 	// from the disk in response to the "get text" message):
 	if (sab.total_length >= g_MaxVarCapacity)    // Allow the command to succeed by truncating the text.
-		sab.total_length = g_MaxVarCapacity - 1; // And this length will be used to limit the retrieval capacity below.
-
-	// Set up the var, enlarging it if necessary.  If the output_var is of type VAR_CLIPBOARD,
-	// this call will set up the clipboard for writing:
-	if (output_var.Assign(NULL, (VarSizeType)sab.total_length) != OK)
-		return FAIL;  // It already displayed the error.
-
-	// Fetch the text directly into the var.  Also set the length explicitly
-	// in case actual size written was different than the esimated size (since
-	// GetWindowTextLength() can return more space that will actually be required
-	// in certain circumstances, see MSDN):
-	sab.buf = output_var.Contents();
-	sab.total_length = 0; // Init
-	// Note: The capacity member below exists because granted capacity might be a little larger than we asked for,
-	// which allows the actual text fetched to be larger than the length estimate retrieved by the first pass
-	// (which generally shouldn't happen since MSDN docs say that the actual length can be less, but never greater,
-	// than the estimate length):
-	sab.capacity = output_var.Capacity(); // Capacity includes the zero terminator, i.e. it's the size of the memory area.
-	EnumChildWindows(target_window, EnumChildGetText, (LPARAM)&sab); // Get the text.
-
-	// Length is set explicitly below in case it wound up being smaller than expected/estimated.
-	// MSDN says that can happen generally, and also specifically because: "ANSI applications may have
-	// the string in the buffer reduced in size (to a minimum of half that of the wParam value) due to
-	// conversion from ANSI to Unicode."
-	output_var.Length() = (VarSizeType)sab.total_length;
-	if (sab.total_length)
+		sab.total_length = g_MaxVarCapacity - 1;
+
+	// Even if there was no text in the window, ErrorLevel indicates success.  But if the enumeration was
+	// cut short, ErrorLevel is left set to 1 even though the text retrieved so far is stored:
+	ResultType result = sab.total_length ? output_var.Assign(sab.buf, (VarSizeType)sab.total_length)
+		: output_var.Assign(); // Tell it not to free the memory by omitting all params.
+	free(sab.buf);
+	if (result == OK && !sab.truncated)
 		g_ErrorLevel->Assign(ERRORLEVEL_NONE); // Indicate success.
-	else // Something went wrong, so make sure we set to empty string.
-		*sab.buf = '\0';  // Safe because Assign() gave us a non-constant memory area.
-	return output_var.Close(); // Must be called after Assign(NULL, ...) or when Contents() has been altered because it updates the variable's attributes and properly handles VAR_CLIPBOARD.
+	return result;
 }
 
 
@@ -3758,26 +3752,53 @@ BOOL CALLBACK EnumChildGetText(HWND aWnd, LPARAM lParam)
 	if (!g->DetectHiddenText && !IsWindowVisible(aWnd))
 		return TRUE;  // This child/control is hidden and user doesn't want it considered, so skip it.
 	length_and_buf_type &lab = *(length_and_buf_type *)lParam;  // For performance and convenience.
-	int length;
-	if (lab.buf)
-		length = GetWindowTextTimeout(aWnd, lab.buf + lab.total_length
-			, (int)(lab.capacity - lab.total_length)); // Not +1.  Verified correct because WM_GETTEXT accepts size of buffer, not its length.
-	else
-		length = GetWindowTextTimeout(aWnd);
-	lab.total_length += length;
-	if (length)
+
+	// Once the deadline has passed, stop enumerating and let the caller return what was retrieved so far.
+	// Otherwise, wait for this control no longer than the per-control timeout or the time left, whichever
+	// is less:
+	int time_left = (int)(lab.deadline - GetTickCount());
+	if (time_left <= 0)
+	{
+		lab.truncated = true;
+		return FALSE;
+	}
+	if (time_left > WINGETTEXT_TIMEOUT)
+		time_left = WINGETTEXT_TIMEOUT;
+	int length = GetWindowTextTimeout(aWnd, NULL, 0, time_left);
+	if (!length) // No text, or the control didn't respond in time.
+		return TRUE;
+
+	size_t space_needed = lab.total_length + length + 3; // +3 for the CRLF delimiter and the zero terminator.
+	if (space_needed > lab.capacity)
 	{
-		if (lab.buf)
+		size_t new_capacity = lab.capacity ? lab.capacity : 4096;
+		while (new_capacity < space_needed)
+			new_capacity *= 2;
+		// Use a temp var. because realloc() returns NULL on failure but leaves original block allocated.
+		char *new_buf = (char *)realloc(lab.buf, new_capacity);
+		if (!new_buf) // Rare, so just return what was retrieved so far.
 		{
-			if (lab.capacity - lab.total_length > 2) // Must be >2 due to zero terminator.
-			{
-				strcpy(lab.buf + lab.total_length, "\r\n"); // Something to delimit each control's text.
-				lab.total_length += 2;
-			}
-			// else don't increment total_length
+			lab.truncated = true;
+			return FALSE;
 		}
-		else
-			lab.total_length += 2; // Since buf is NULL, accumulate the size that *would* be needed.
+		lab.buf = new_buf;
+		lab.capacity = new_capacity;
+	}
+
+	if (   (time_left = (int)(lab.deadline - GetTickCount())) <= 0   )
+	{
+		lab.truncated = true;
+		return FALSE;
+	}
+	if (time_left > WINGETTEXT_TIMEOUT)
+		time_left = WINGETTEXT_TIMEOUT;
+	// Pass the entire remaining capacity (excluding room for the delimiter) rather than just length+1
+	// because the estimate retrieved above can, in rare cases, be smaller than the actual text:
+	if (   length = GetWindowTextTimeout(aWnd, lab.buf + lab.total_length, (int)(lab.capacity - lab.total_length - 2), time_left)   )
+	{
+		lab.total_length += length;
+		strcpy(lab.buf + lab.total_length, "\r\n"); // Something to delimit each control's text.
+		lab.total_length += 2;
 	}
 	return TRUE; // Continue enumeration through all the child windows of this parent.
 }
@@ -4037,10 +4058,13 @@ BOOL CALLBACK EnumMonitorProc(HMONITOR hMonitor, HDC hdcMonitor, LPRECT lprcMoni
 
 
 
-LPCOLORREF getbits(HBITMAP ahImage, HDC hdc, LONG &aWidth, LONG &aHeight, bool &aIs16Bit, int aMinColorDepth = 8)
+LPCOLORREF getbits(HBITMAP ahImage, HDC hdc, LONG &aWidth, LONG &aHeight, bool &aIs16Bit, int aMinColorDepth = 8
+	, LPCOLORREF aBuf = NULL, LONG aBufPixelCount = 0)
 // Helper function used by PixelSearch below.
 // Returns an array of pixels to the caller, which it must free when done.  Returns NULL on failure,
 // in which case the contents of the output parameters is indeterminate.
+// If aBuf is non-NULL and has room for at least aBufPixelCount pixels, the pixels are stored there if they
+// fit, in which case aBuf itself is returned (and the caller must not free it separately).
 {
 	HDC tdc = CreateCompatibleDC(hdc);
 	if (!tdc)
@@ -4077,7 +4101,9 @@ LPCOLORREF getbits(HBITMAP ahImage, HDC hdc, LONG &aWidth, LONG &aHeight, bool &
 	aHeight = bmi.bmiHeader.biHeight;
 
 	int image_pixel_count = aWidth * aHeight;
-	if (   !(image_pixel = (LPCOLORREF)malloc(image_pixel_count * sizeof(COLORREF)))   )
+	if (aBuf && image_pixel_count <= aBufPixelCount)
+		image_pixel = aBuf;
+	else if (   !(image_pixel = (LPCOLORREF)malloc(image_pixel_count * sizeof(COLORREF)))   )
 		goto end;
 
 	// v1.0.40.10: To preserve compatibility with callers who check for transparency in icons, don't do any
@@ -4143,7 +4169,8 @@ end:
 	DeleteDC(tdc);
 	if (!success && image_pixel)
 	{
-		free(image_pixel);
+		if (image_pixel != aBuf)
+			free(image_pixel);
 		image_pixel = NULL;
 	}
 	return image_pixel;
@@ -4151,6 +4178,97 @@ end:
 
 
 
+// PixelSearch is often called many times per second on a region of the same size, so the memory DC,
+// bitmap and pixel array used to capture the screen are kept for reuse rather than being created and
+// destroyed by every call.  They're recreated whenever the size of the region changes.  Since a capture
+// of the entire screen is large, FreeScreenCapture() releases all of it whenever the script becomes idle
+// (see MsgSleep) and when the display mode changes (which would also make the bitmap's format obsolete).
+struct ScreenCaptureType
+{
+	HDC dc;
+	HBITMAP bitmap;
+	HGDIOBJ dc_orig_select;
+	int width, height;
+	LPCOLORREF pixel;      // Retains the last capture's pixels; NULL if none yet.
+	LONG pixel_count_max;  // Capacity of the above.
+};
+static ScreenCaptureType sScreenCapture = {0};
+
+static void FreeScreenCaptureDC(ScreenCaptureType &aCapture)
+// Frees the GDI objects but keeps the pixel array for reuse.
+{
+	if (aCapture.dc)
+	{
+		if (aCapture.dc_orig_select) // i.e. the original call to SelectObject() didn't fail.
+			SelectObject(aCapture.dc, aCapture.dc_orig_select); // Probably necessary to prevent memory leak.
+		DeleteDC(aCapture.dc);
+		aCapture.dc = NULL;
+	}
+	if (aCapture.bitmap)
+	{
+		DeleteObject(aCapture.bitmap);
+		aCapture.bitmap = NULL;
+	}
+	aCapture.dc_orig_select = NULL;
+}
+
+
+
+void FreeScreenCapture()
+{
+	FreeScreenCaptureDC(sScreenCapture);
+	if (sScreenCapture.pixel)
+	{
+		free(sScreenCapture.pixel);
+		sScreenCapture.pixel = NULL;
+		sScreenCapture.pixel_count_max = 0;
+	}
+}
+
+
+
+LPCOLORREF CaptureScreenRegion(HDC hdc, int aLeft, int aTop, int aWidth, int aHeight
+	, LONG &aScreenWidth, LONG &aScreenHeight, bool &aIs16Bit)
+// Copies the specified region of the screen (hdc) and returns its pixels in the same format as getbits().
+// The returned array belongs to sScreenCapture, so the caller must not free it, and it remains valid only
+// until the next call.  Returns NULL on failure.
+{
+	ScreenCaptureType &cap = sScreenCapture;
+	if (!cap.dc || cap.width != aWidth || cap.height != aHeight)
+	{
+		FreeScreenCaptureDC(cap);
+		// Some explanation for the method below is contained in this quote from the newsgroups:
+		// "you shouldn't really be getting the current bitmap from the GetDC DC. This might
+		// have weird effects like returning the entire screen or not working. Create yourself
+		// a memory DC first of the correct size. Then BitBlt into it and then GetDIBits on
+		// that instead. This way, the provider of the DC (the video driver) can make sure that
+		// the correct pixels are copied across."
+		if (   !(cap.dc = CreateCompatibleDC(hdc)) || !(cap.bitmap = CreateCompatibleBitmap(hdc, aWidth, aHeight))
+			|| !(cap.dc_orig_select = SelectObject(cap.dc, cap.bitmap))   )
+		{
+			FreeScreenCaptureDC(cap);
+			return NULL;
+		}
+		cap.width = aWidth;
+		cap.height = aHeight;
+	}
+
+	// Copy the pixels in the search-area of the screen into the DC to be searched:
+	if (!BitBlt(cap.dc, 0, 0, aWidth, aHeight, hdc, aLeft, aTop, SRCCOPY))
+		return NULL;
+
+	LPCOLORREF pixel = getbits(cap.bitmap, cap.dc, aScreenWidth, aScreenHeight, aIs16Bit, 8, cap.pixel, cap.pixel_count_max);
+	if (pixel && pixel != cap.pixel) // getbits() had to allocate a larger array, so it replaces the old one.
+	{
+		free(cap.pixel);
+		cap.pixel = pixel;
+		cap.pixel_count_max = aScreenWidth * aScreenHeight;
+	}
+	return pixel;
+}
+
+
+
 ResultType Line::PixelSearch(int aLeft, int aTop, int aRight, int aBottom, COLORREF aColorBGR
 	, int aVariation, char *aOptions, bool aIsPixelGetColor)
 // Caller has ensured that aColor is in BGR format unless caller passed true for aUseRGB, in which case
@@ -4221,36 +4339,13 @@ ResultType Line::PixelSearch(int aLeft, int aTop, int aRight, int aBottom, COLOR
 
 	if (fast_mode)
 	{
-		// From this point on, "goto fast_end" will assume hdc is non-NULL but that the below might still be NULL.
-		// Therefore, all of the following must be initialized so that the "fast_end" label can detect them:
-		HDC sdc = NULL;
-		HBITMAP hbitmap_screen = NULL;
-		LPCOLORREF screen_pixel = NULL;
-		HGDIOBJ sdc_orig_select = NULL;
-
-		// Some explanation for the method below is contained in this quote from the newsgroups:
-		// "you shouldn't really be getting the current bitmap from the GetDC DC. This might
-		// have weird effects like returning the entire screen or not working. Create yourself
-		// a memory DC first of the correct size. Then BitBlt into it and then GetDIBits on
-		// that instead. This way, the provider of the DC (the video driver) can make sure that
-		// the correct pixels are copied across."
-
-		// Create an empty bitmap to hold all the pixels currently visible on the screen (within the search area):
-		int search_width = aRight - aLeft + 1;
-		int search_height = aBottom - aTop + 1;
-		if (   !(sdc = CreateCompatibleDC(hdc)) || !(hbitmap_screen = CreateCompatibleBitmap(hdc, search_width, search_height))   )
-			goto fast_end;
-
-		if (   !(sdc_orig_select = SelectObject(sdc, hbitmap_screen))   )
-			goto fast_end;
-
-		// Copy the pixels in the search-area of the screen into the DC to be searched:
-		if (   !(BitBlt(sdc, 0, 0, search_width, search_height, hdc, aLeft, aTop, SRCCOPY))   )
-			goto fast_end;
-
+		// From this point on, "goto fast_end" will assume hdc is non-NULL.  The capture's pixel array is
+		// owned by CaptureScreenRegion(), so it isn't freed here:
 		LONG screen_width, screen_height;
 		bool screen_is_16bit;
-		if (   !(screen_pixel = getbits(hbitmap_screen, sdc, screen_width, screen_height, screen_is_16bit))   )
+		LPCOLORREF screen_pixel = CaptureScreenRegion(hdc, aLeft, aTop, aRight - aLeft + 1, aBottom - aTop + 1
+			, screen_width, screen_height, screen_is_16bit);
+		if (!screen_pixel)
 			goto fast_end;
 
 		// Concerning 0xF8F8F8F8: "On 16bit and 15 bit color the first 5 bits in each byte are valid
@@ -4334,16 +4429,6 @@ fast_end:
 		// If found==false when execution reaches here, ErrorLevel is already set to the right value, so just
 		// clean up then return.
 		ReleaseDC(NULL, hdc);
-		if (sdc)
-		{
-			if (sdc_orig_select) // i.e. the original call to SelectObject() didn't fail.
-				SelectObject(sdc, sdc_orig_select); // Probably necessary to prevent memory leak.
-			DeleteDC(sdc);
-		}
-		if (hbitmap_screen)
-			DeleteObject(hbitmap_screen);
-		if (screen_pixel)
-			free(screen_pixel);
 
 		if (!found) // Let ErrorLevel, which is either "1" or "2" as set earlier, tell the story.
 			return OK;
@@ -4566,10 +4651,8 @@ ResultType Line::ImageSearch(int aLeft, int aTop, int aRight, int aBottom, char
 	// From this point on, "goto end" will assume hdc and hbitmap_image are non-NULL, but that the below
 	// might still be NULL.  Therefore, all of the following must be initialized so that the "end"
 	// label can detect them:
-	HDC sdc = NULL;
-	HBITMAP hbitmap_screen = NULL;
-	LPCOLORREF image_pixel = NULL, screen_pixel = NULL, image_mask = NULL;
-	HGDIOBJ sdc_orig_select = NULL;
+	LPCOLORREF image_pixel = NULL, screen_pixel = NULL, image_mask = NULL; // screen_pixel is owned by CaptureScreenRegion(), so it isn't freed here.
+	LPCOLORREF image_low = NULL; // Used only in variation mode.
 	bool found = false; // Must init here for use by "goto end".
     
 	bool image_is_16bit;
@@ -4602,27 +4685,17 @@ ResultType Line::ImageSearch(int aLeft, int aTop, int aRight, int aBottom, char
 	if (   !(image_pixel = getbits(hbitmap_image, hdc, image_width, image_height, image_is_16bit))   )
 		goto end;
 
-	// Create an empty bitmap to hold all the pixels currently visible on the screen that lie within the search area:
-	int search_width = aRight - aLeft + 1;
-	int search_height = aBottom - aTop + 1;
-	if (   !(sdc = CreateCompatibleDC(hdc)) || !(hbitmap_screen = CreateCompatibleBitmap(hdc, search_width, search_height))   )
-		goto end;
-
-	if (   !(sdc_orig_select = SelectObject(sdc, hbitmap_screen))   )
-		goto end;
-
-	// Copy the pixels in the search-area of the screen into the DC to be searched:
-	if (   !(BitBlt(sdc, 0, 0, search_width, search_height, hdc, aLeft, aTop, SRCCOPY))   )
-		goto end;
-
+	// Copy the pixels currently visible on the screen that lie within the search area:
 	LONG screen_width, screen_height;
 	bool screen_is_16bit;
-	if (   !(screen_pixel = getbits(hbitmap_screen, sdc, screen_width, screen_height, screen_is_16bit))   )
+	if (   !(screen_pixel = CaptureScreenRegion(hdc, aLeft, aTop, aRight - aLeft + 1, aBottom - aTop + 1
+		, screen_width, screen_height, screen_is_16bit))   )
 		goto end;
 
 	LONG image_pixel_count = image_width * image_height;
 	LONG screen_pixel_count = screen_width * screen_height;
 	int i, j, k, x, y; // Declaring as "register" makes no performance difference with current compiler, so let the compiler choose which should be registers.
+	int cx, cy; // Column and row of the current candidate's upper-left pixel within the search region.
 
 	// If either is 16-bit, convert *both* to the 16-bit-compatible 32-bit format:
 	if (image_is_16bit || screen_is_16bit)
@@ -4644,6 +4717,24 @@ ResultType Line::ImageSearch(int aLeft, int aTop, int aRight, int aBottom, char
 	for (i = 0; i < image_pixel_count; ++i)
 		image_pixel[i] &= 0x00FFFFFF;
 
+	// Rather than visiting every pixel of the search region as a candidate (and dividing to find each one's
+	// row and column to see whether the image fits there), only the candidates at which the image fits
+	// entirely within the region are visited.  They're visited in the same left-to-right, top-to-bottom order
+	// as before so that the same match is found.  Each candidate is first checked against a single "sample"
+	// pixel of the image, which rejects nearly all non-matching candidates with one comparison.  The first
+	// opaque pixel is used rather than always the first pixel so that this remains effective for images
+	// whose corners are transparent (such as most icons and *Trans images).
+	int last_x = screen_width - image_width;   // Candidates further right or down would extend past
+	int last_y = screen_height - image_height; // the edges of the search region.
+	int sample_j, sample_offset = 0; // The sample pixel's index within the image and its offset from a candidate's upper-left pixel.
+	for (sample_j = 0; sample_j < image_pixel_count; ++sample_j)
+		if (!(image_mask && image_mask[sample_j] || image_pixel[sample_j] == trans_color))
+			break;
+	if (sample_j < image_pixel_count)
+		sample_offset = (sample_j / image_width) * screen_width + sample_j % image_width;
+	else // The image is entirely transparent, so it matches at every candidate.
+		sample_j = -1;
+
 	// Search the specified region for the first occurrence of the image:
 	if (aVariation < 1) // Caller wants an exact match.
 	{
@@ -4661,23 +4752,13 @@ ResultType Line::ImageSearch(int aLeft, int aTop, int aRight, int aBottom, char
 		for (i = 0; i < screen_pixel_count; ++i)
 			screen_pixel[i] &= 0x00FFFFFF;
 
-		for (i = 0; i < screen_pixel_count; ++i)
+		for (cy = 0; cy <= last_y && !found; ++cy)
 		{
-			// Unlike the variation-loop, the following one uses a first-pixel optimization to boost performance
-			// by about 10% because it's only 3 extra comparisons and exact-match mode is probably used more often.
-			// Before even checking whether the other adjacent pixels in the region match the image, ensure
-			// the image does not extend past the right or bottom edges of the current part of the search region.
-			// This is done for performance but more importantly to prevent partial matches at the edges of the
-			// search region from being considered complete matches.
-			// The following check is ordered for short-circuit performance.  In addition, image_mask, if
-			// non-NULL, is used to determine which pixels are transparent within the image and thus should
-			// match any color on the screen.
-			if ((screen_pixel[i] == image_pixel[0] // A screen pixel has been found that matches the image's first pixel.
-				|| image_mask && image_mask[0]     // Or: It's an icon's transparent pixel, which matches any color.
-				|| image_pixel[0] == trans_color)  // This should be okay even if trans_color==CLR_NONE, since CLR_NONE should never occur naturally in the image.
-				&& image_height <= screen_height - i/screen_width // Image is short enough to fit in the remaining rows of the search region.
-				&& image_width <= screen_width - i%screen_width)  // Image is narrow enough not to exceed the right-side boundary of the search region.
+			for (cx = 0, i = cy*screen_width; cx <= last_x; ++cx, ++i)
 			{
+				// The sample pixel rejects nearly all non-matching candidates with a single comparison (see above).
+				if (sample_j > -1 && screen_pixel[i + sample_offset] != image_pixel[sample_j])
+					continue;
 				// Check if this candidate region -- which is a subset of the search region whose height and width
 				// matches that of the image -- is a pixel-for-pixel match of the image.
 				for (found = true, x = 0, y = 0, j = 0, k = i; j < image_pixel_count; ++j)
@@ -4705,62 +4786,41 @@ ResultType Line::ImageSearch(int aLeft, int aTop, int aRight, int aBottom, char
 	}
 	else // Allow colors to vary by aVariation shades; i.e. approximate match is okay.
 	{
-		// The following section is part of the first-pixel-check optimization that improves performance by
-		// 15% or more depending on where and whether a match is found.  This section and one the follows
-		// later is commented out to reduce code size.
-		// Set high/low range for the first pixel of the image since it is the pixel most often checked
-		// (i.e. for performance).
-		//BYTE search_red1 = GetBValue(image_pixel[0]);  // Because it's RGB vs. BGR, the B value is fetched, not R (though it doesn't matter as long as everything is internally consistent here).
-		//BYTE search_green1 = GetGValue(image_pixel[0]);
-		//BYTE search_blue1 = GetRValue(image_pixel[0]); // Same comment as above.
-		//BYTE red_low1 = (aVariation > search_red1) ? 0 : search_red1 - aVariation;
-		//BYTE green_low1 = (aVariation > search_green1) ? 0 : search_green1 - aVariation;
-		//BYTE blue_low1 = (aVariation > search_blue1) ? 0 : search_blue1 - aVariation;
-		//BYTE red_high1 = (aVariation > 0xFF - search_red1) ? 0xFF : search_red1 + aVariation;
-		//BYTE green_high1 = (aVariation > 0xFF - search_green1) ? 0xFF : search_green1 + aVariation;
-		//BYTE blue_high1 = (aVariation > 0xFF - search_blue1) ? 0xFF : search_blue1 + aVariation;
-		// Above relies on the fact that the 16-bit conversion higher above was already done because like
-		// in PixelSearch, it seems more appropriate to do the 16-bit conversion prior to setting the range
-		// of high and low colors (vs. than applying 0xF8 to each of the high/low values individually).
-
-		BYTE red, green, blue;
 		BYTE search_red, search_green, search_blue;
 		BYTE red_low, green_low, blue_low, red_high, green_high, blue_high;
 
+		// Calculate the range of colors that match each pixel of the image once here rather than once for every
+		// candidate.  The low and high ends of each range are stored in the same format as the pixels themselves
+		// so that the components can be compared directly.  Like in PixelSearch, it seems more appropriate to do
+		// this after the 16-bit conversion higher above (vs. applying 0xF8 to each of the high/low values).
+		if (   !(image_low = (LPCOLORREF)malloc(2 * image_pixel_count * sizeof(COLORREF)))   )
+			goto end;
+		LPCOLORREF image_high = image_low + image_pixel_count;
+		for (j = 0; j < image_pixel_count; ++j)
+		{
+			search_red = GetBValue(image_pixel[j]);  // Because it's RGB vs. BGR, the B value is fetched, not R (though it doesn't matter as long as everything is internally consistent here).
+			search_green = GetGValue(image_pixel[j]);
+			search_blue = GetRValue(image_pixel[j]); // Same comment as above.
+			SET_COLOR_RANGE
+			image_low[j] = RGB(blue_low, green_low, red_low);    // Reverse order for the same reason as above.
+			image_high[j] = RGB(blue_high, green_high, red_high);
+		}
+		#define PIXEL_IS_IN_RANGE(pixel, j) \
+			(GetRValue(pixel) >= GetRValue(image_low[j]) && GetRValue(pixel) <= GetRValue(image_high[j])\
+			&& GetGValue(pixel) >= GetGValue(image_low[j]) && GetGValue(pixel) <= GetGValue(image_high[j])\
+			&& GetBValue(pixel) >= GetBValue(image_low[j]) && GetBValue(pixel) <= GetBValue(image_high[j]))
+
 		// The following loop is very similar to its counterpart above that finds an exact match, so maintain
 		// them together and see above for more detailed comments about it.
-		for (i = 0; i < screen_pixel_count; ++i)
+		for (cy = 0; cy <= last_y && !found; ++cy)
 		{
-			// The following is commented out to trade code size reduction for performance (see comment above).
-			//red = GetBValue(screen_pixel[i]);   // Because it's RGB vs. BGR, the B value is fetched, not R (though it doesn't matter as long as everything is internally consistent here).
-			//green = GetGValue(screen_pixel[i]);
-			//blue = GetRValue(screen_pixel[i]);
-			//if ((red >= red_low1 && red <= red_high1
-			//	&& green >= green_low1 && green <= green_high1
-			//	&& blue >= blue_low1 && blue <= blue_high1 // All three color components are a match, so this screen pixel matches the image's first pixel.
-			//		|| image_mask && image_mask[0]         // Or: It's an icon's transparent pixel, which matches any color.
-			//		|| image_pixel[0] == trans_color)      // This should be okay even if trans_color==CLR_NONE, since CLR none should never occur naturally in the image.
-			//	&& image_height <= screen_height - i/screen_width // Image is short enough to fit in the remaining rows of the search region.
-			//	&& image_width <= screen_width - i%screen_width)  // Image is narrow enough not to exceed the right-side boundary of the search region.
-			
-			// Instead of the above, only this abbreviated check is done:
-			if (image_height <= screen_height - i/screen_width    // Image is short enough to fit in the remaining rows of the search region.
-				&& image_width <= screen_width - i%screen_width)  // Image is narrow enough not to exceed the right-side boundary of the search region.
+			for (cx = 0, i = cy*screen_width; cx <= last_x; ++cx, ++i)
 			{
-				// Since the first pixel is a match, check the other pixels.
+				if (sample_j > -1 && !PIXEL_IS_IN_RANGE(screen_pixel[i + sample_offset], sample_j))
+					continue;
 				for (found = true, x = 0, y = 0, j = 0, k = i; j < image_pixel_count; ++j)
 				{
-   					search_red = GetBValue(image_pixel[j]);
-	   				search_green = GetGValue(image_pixel[j]);
-		   			search_blue = GetRValue(image_pixel[j]);
-					SET_COLOR_RANGE
-   					red = GetBValue(screen_pixel[k]);
-	   				green = GetGValue(screen_pixel[k]);
-		   			blue = GetRValue(screen_pixel[k]);
-
-					if (!(found = red >= red_low && red <= red_high
-						&& green >= green_low && green <= green_high
-                        && blue >= blue_low && blue <= blue_high
+					if (!(found = PIXEL_IS_IN_RANGE(screen_pixel[k], j)
 							|| image_mask && image_mask[j]     // Or: It's an icon's transparent pixel, which matches any color.
 							|| image_pixel[j] == trans_color)) // This should be okay even if trans_color==CLR_NONE, since CLR_NONE should never occur naturally in the image.
 						break; // At least one pixel doesn't match, so this candidate is discarded.
@@ -4787,20 +4847,12 @@ end:
 	// clean up then return.
 	ReleaseDC(NULL, hdc);
 	DeleteObject(hbitmap_image);
-	if (sdc)
-	{
-		if (sdc_orig_select) // i.e. the original call to SelectObject() didn't fail.
-			SelectObject(sdc, sdc_orig_select); // Probably necessary to prevent memory leak.
-		DeleteDC(sdc);
-	}
-	if (hbitmap_screen)
-		DeleteObject(hbitmap_screen);
 	if (image_pixel)
 		free(image_pixel);
 	if (image_mask)
 		free(image_mask);
-	if (screen_pixel)
-		free(screen_pixel);
+	if (image_low)
+		free(image_low);
 
 	if (!found) // Let ErrorLevel, which is either "1" or "2" as set earlier, tell the story.
 		return OK;
@@ -5228,6 +5280,10 @@ LRESULT CALLBACK MainWindowProc(HWND hWnd, UINT iMsg, WPARAM wParam, LPARAM lPar
 		}
 		break;
 
+	case WM_DISPLAYCHANGE:
+		FreeScreenCapture(); // The retained capture is the wrong size and perhaps the wrong color depth now.
+		break; // Let DWP handle it.
+
 	case WM_DRAWCLIPBOARD:
 		if (g_script.mOnClipboardChangeLabel) // In case it's a bogus msg, it's our responsibility to avoid posting the msg if there's no label to launch.
 			PostMessage(g_hWnd, AHK_CLIPBOARD_CHANGE, 0, 0); // It's done this way to buffer it when the script is uninterruptible, etc.  v1.0.44: Post to g_hWnd vs. NULL so that notifications aren't lost when script is displaying a MsgBox or other dialog.
@@ -5258,6 +5314,21 @@ LRESULT CALLBACK MainWindowProc(HWND hWnd, UINT iMsg, WPARAM wParam, LPARAM lPar
 		// it might do more harm than good).
 		return 0;
 
+	case AHK_PROFILE_DUMP:
+		// Allows the profile report to be written on demand (e.g. by another script or a debugging tool)
+		// without waiting for the script to exit.  If lParam is non-zero, it's an ATOM whose name is the
+		// file to write; otherwise the file given to the /Profile switch is used.  Returns 1 on success.
+		if (!ScriptProfiler::IsEnabled())
+			return 0;
+		if (lParam)
+		{
+			char profile_file[MAX_PATH];
+			if (!GlobalGetAtomName((ATOM)lParam, profile_file, sizeof(profile_file)))
+				return 0;
+			return ScriptProfiler::WriteReport(profile_file) == OK;
+		}
+		return ScriptProfiler::WriteReport() == OK;
+
 	case AHK_RETURN_PID:
 		// This is obsolete in light of WinGet's support for fetching the PID of any window.
 		// But since it's simple, it is retained for backward compatibility.
@@ -8834,6 +8905,96 @@ ResultType Line::FileReadLine(char *aFilespec, char *aLineNumber)
 
 
 
+// FileAppend is often called many times in a row for the same few files (such as logging), so the files
+// it opens are kept open for a short time rather than being opened and closed by every call.  Each write
+// is still flushed immediately so that other readers (including FileRead and Loop Read) always see the
+// complete file.  A file is closed once it has gone unused for FILE_APPEND_CACHE_TIMEOUT or the script
+// becomes idle (see MsgSleep), and also prior to any command that might need exclusive access to it
+// (FileDelete, FileMove, FileCopy, etc.).
+#define FILE_APPEND_CACHE_SIZE 8
+struct FileAppendCacheItem
+{
+	char path[MAX_PATH]; // Full path, so that changes to the working directory don't matter.
+	bool is_binary;
+	FILE *fp;
+	DWORD last_used;
+};
+static FileAppendCacheItem sFileAppendCache[FILE_APPEND_CACHE_SIZE];
+static int sFileAppendCacheCount = 0;
+
+
+
+void CloseCachedAppendFiles(char *aFilespec, DWORD aMinIdleTime)
+// Closes the cached FileAppend files that match aFilespec and have gone unused for at least aMinIdleTime.
+// If aFilespec is NULL, contains wildcards or is a directory, all files are considered to match.
+{
+	if (!sFileAppendCacheCount) // By far the most common case.
+		return;
+	char path[MAX_PATH], *filename_marker;
+	DWORD length;
+	bool close_all = !aFilespec || StrChrAny(aFilespec, "?*")
+		|| !(length = GetFullPathName(aFilespec, sizeof(path), path, &filename_marker)) || length >= sizeof(path);
+	DWORD tick_now = GetTickCount();
+	for (int i = sFileAppendCacheCount - 1; i >= 0; --i)
+	{
+		FileAppendCacheItem &item = sFileAppendCache[i];
+		if (!close_all && stricmp(item.path, path) || tick_now - item.last_used < aMinIdleTime)
+			continue;
+		fclose(item.fp);
+		item = sFileAppendCache[--sFileAppendCacheCount]; // Move the last item into the vacated slot.
+	}
+}
+
+
+
+static FILE *OpenCachedAppendFile(char *aFilespec, bool aIsBinary, bool &aIsCached)
+// Returns the open file, or NULL on failure.  If aIsCached is set to false, the file couldn't be cached,
+// so the caller must close it.
+{
+	aIsCached = false;
+	char path[MAX_PATH], *filename_marker;
+	DWORD length = GetFullPathName(aFilespec, sizeof(path), path, &filename_marker);
+	if (!length || length >= sizeof(path)) // Too rare to be worth caching.
+		return fopen(aFilespec, aIsBinary ? "ab" : "a");
+
+	int i;
+	for (i = 0; i < sFileAppendCacheCount; ++i)
+		if (!stricmp(sFileAppendCache[i].path, path))
+			break;
+	if (i < sFileAppendCacheCount) // This file is already open.
+	{
+		if (sFileAppendCache[i].is_binary == aIsBinary)
+		{
+			sFileAppendCache[i].last_used = GetTickCount();
+			aIsCached = true;
+			return sFileAppendCache[i].fp;
+		}
+		CloseCachedAppendFiles(path); // It's open in the other mode, so reopen it below.
+	}
+
+	FILE *fp = fopen(aFilespec, aIsBinary ? "ab" : "a");
+	if (!fp)
+		return NULL;
+	if (sFileAppendCacheCount == FILE_APPEND_CACHE_SIZE) // Make room by closing the least recently used file.
+	{
+		int lru = 0;
+		for (i = 1; i < sFileAppendCacheCount; ++i)
+			if (GetTickCount() - sFileAppendCache[i].last_used > GetTickCount() - sFileAppendCache[lru].last_used)
+				lru = i;
+		fclose(sFileAppendCache[lru].fp);
+		sFileAppendCache[lru] = sFileAppendCache[--sFileAppendCacheCount];
+	}
+	FileAppendCacheItem &item = sFileAppendCache[sFileAppendCacheCount++];
+	strcpy(item.path, path);
+	item.is_binary = aIsBinary;
+	item.fp = fp;
+	item.last_used = GetTickCount();
+	aIsCached = true;
+	return fp;
+}
+
+
+
 ResultType Line::FileAppend(char *aFilespec, char *aBuf, LoopReadFileStruct *aCurrentReadFile)
 {
 	// The below is avoided because want to allow "nothing" to be written to a file in case the
@@ -8882,6 +9043,7 @@ ResultType Line::FileAppend(char *aFilespec, char *aBuf, LoopReadFileStruct *aCu
 				// 1) Duplicate clipboard formats not making sense (i.e. two CF_TEXT formats would cause the
 				//    first to be overwritten by the second when restoring to clipboard).
 				// 2) There is a 4-byte zero terminator at the end of the file.
+				CloseCachedAppendFiles(aFilespec); // Since it's about to be overwritten.
 				if (   !(fp = fopen(aFilespec, "wb"))   ) // Overwrite.
 					return g_ErrorLevel->Assign(ERRORLEVEL_ERROR);
 				g_ErrorLevel->Assign(fwrite(ARGVAR1->Contents(), ARGVAR1->Length() + 1, 1, fp)
@@ -8909,21 +9071,28 @@ ResultType Line::FileAppend(char *aFilespec, char *aBuf, LoopReadFileStruct *aCu
 	// 2) To avoid opening the file if the file-reading loop has zero iterations (i.e. it's
 	//    opened only upon first actual use to help performance and avoid changing the
 	//    file-modification time when no actual text will be appended).
+	bool is_cached = false;
 	if (!file_was_already_open)
 	{
 		// Open the output file (if one was specified).  Unlike the input file, this is not
 		// a critical error if it fails.  We want it to be non-critical so that FileAppend
 		// commands in the body of the loop will set ErrorLevel to indicate the problem:
-		if (   !(fp = fopen(aFilespec, open_as_binary ? "ab" : "a"))   )
-			return g_ErrorLevel->Assign(ERRORLEVEL_ERROR);
 		if (aCurrentReadFile)
+		{
+			if (   !(fp = fopen(aFilespec, open_as_binary ? "ab" : "a"))   )
+				return g_ErrorLevel->Assign(ERRORLEVEL_ERROR);
 			aCurrentReadFile->mWriteFile = fp;
+		}
+		else
+			if (   !(fp = OpenCachedAppendFile(aFilespec, open_as_binary, is_cached))   )
+				return g_ErrorLevel->Assign(ERRORLEVEL_ERROR);
 	}
 
-	// Write to the file:
-	g_ErrorLevel->Assign(fputs(aBuf, fp) ? ERRORLEVEL_ERROR : ERRORLEVEL_NONE); // fputs() returns 0 on success.
+	// Write to the file.  A cached file is flushed so that the file is complete as seen by anything else
+	// that reads it, just as it would be if it had been closed:
+	g_ErrorLevel->Assign(fputs(aBuf, fp) || is_cached && fflush(fp) ? ERRORLEVEL_ERROR : ERRORLEVEL_NONE); // fputs() and fflush() return 0 on success.
 
-	if (!aCurrentReadFile)
+	if (!aCurrentReadFile && !is_cached)
 		fclose(fp);
 	// else it's the caller's responsibility, or it's caller's, to close it.
 
@@ -8944,6 +9113,7 @@ ResultType Line::WriteClipboardToFile(char *aFilespec)
 
 	g_ErrorLevel->Assign(ERRORLEVEL_ERROR); // Set default.
 
+	CloseCachedAppendFiles(aFilespec); // Since the file is opened unsharable below.
 	HANDLE hfile = CreateFile(aFilespec, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, 0, NULL); // Overwrite. Unsharable (since reading the file while it is being written would probably produce bad data in this case).
 	if (hfile == INVALID_HANDLE_VALUE)
 		return g_clip.Close(); // Let ErrorLevel tell the story.
@@ -9096,6 +9266,8 @@ ResultType Line::FileDelete()
 	if (!*aFilePattern)
 		return OK;  // Let ErrorLevel indicate an error, since this is probably not what the user intended.
 
+	CloseCachedAppendFiles(aFilePattern); // Otherwise, a file FileAppend is keeping open couldn't be deleted.
+
 	if (!StrChrAny(aFilePattern, "?*"))
 	{
 		if (DeleteFile(aFilePattern))
@@ -9175,6 +9347,7 @@ ResultType Line::FileInstall(char *aSource, char *aDest, char *aFlag)
 {
 	g_ErrorLevel->Assign(ERRORLEVEL_ERROR); // Set default ErrorLevel.
 	bool allow_overwrite = (ATOI(aFlag) == 1);
+	CloseCachedAppendFiles(); // Otherwise, a destination file FileAppend is keeping open couldn't be overwritten.
 #ifdef AUTOHOTKEYSC
 	if (!allow_overwrite && Util_DoesFileExist(aDest))
 		return OK; // Let ErrorLevel tell the story.
@@ -12390,8 +12563,39 @@ void BIF_InStr(ExprTokenType &aResultToken, ExprTokenType *aParam[], int aParamC
 
 
 
+// THE REGEX CACHE used by get_compiled_regex().
+// This is a very crude cache for linear search. Of course, hashing would be better in the sense that it
+// would allow the cache to get much larger while still being fast (I believe PHP caches up to 4096 items).
+// Binary search might not be such a good idea in this case due to the time required to find the right spot
+// to insert a new cache item (however, items aren't inserted often, so it might perform quite well until
+// the cache contained thousands of RegEx's, which is unlikely to ever happen in most scripts).
+struct pcre_cache_entry
+{
+	// For simplicity (and thus performance), the entire RegEx pattern including its options is cached
+	// is stored in re_raw and that entire string becomes the RegEx's unique identifier for the purpose
+	// of finding an entry in the cache.  Technically, this isn't optimal because some options like Study
+	// and aGetPositionsNotSubstrings don't alter the nature of the compiled RegEx.  However, the CPU time
+	// required to strip off some options prior to doing a cache search seems likely to offset much of the
+	// cache's benefit.  So for this reason, as well as rarity and code size issues, this policy seems best.
+	char *re_raw;      // The RegEx's literal string pattern such as "abc.*123".
+	pcre *re_compiled; // The RegEx in compiled form.
+	pcre_extra *extra; // NULL unless a study() was done (and NULL even then if study() didn't find anything).
+	// int pcre_options; // Not currently needed in the cache since options are implicitly inside re_compiled.
+	bool get_positions_not_substrings;
+	int pin_count; // Number of get_compiled_regex(..., true) calls not yet undone by release_compiled_regex().  A pinned entry is never discarded.
+};
+
+#define PCRE_CACHE_SIZE 100 // Going too high would be counterproductive due to the slowness of linear search (and also the memory utilization of so many compiled RegEx's).
+static pcre_cache_entry sCache[PCRE_CACHE_SIZE] = {{0}}; // Protected by g_CriticalRegExCache.
+// At most this many entries may be pinned at once, so that an entry can always be found to overwrite.
+// Pins come from window searches, which can be nested and can be in progress on both threads at once:
+#define PCRE_CACHE_MAX_PINNED (PCRE_CACHE_SIZE / 2)
+static int sPinnedEntryCount = 0; // Number of entries whose pin_count is non-zero.  Protected by g_CriticalRegExCache.
+
+
+
 pcre *get_compiled_regex(char *aRegEx, bool &aGetPositionsNotSubstrings, pcre_extra *&aExtra
-	, ExprTokenType *aResultToken)
+	, ExprTokenType *aResultToken, bool aPin)
 // Returns the compiled RegEx, or NULL on failure.
 // This function is called by things other than built-in functions so it should be kept general-purpose.
 // Upon failure, if aResultToken!=NULL:
@@ -12401,6 +12605,12 @@ pcre *get_compiled_regex(char *aRegEx, bool &aGetPositionsNotSubstrings, pcre_ex
 //    aGetPositionsNotSubstrings
 //    aExtra
 //    (but it doesn't change ErrorLevel on success, not even if aResultToken!=NULL)
+// If aPin is true, the returned RegEx stays valid (is never discarded from the cache) until the caller
+// passes it to release_compiled_regex().  This allows a caller such as a window search to keep using it
+// even if another thread adds other RegEx's to the cache in the meantime.  Otherwise, the returned RegEx
+// is valid only until the next call to this function.  If aPin is true but PCRE_CACHE_MAX_PINNED entries
+// are already pinned, NULL is returned without compiling anything (aResultToken must be NULL in that case),
+// so the caller should fall back to RegExMatch(char *, char *) for each match it needs.
 {
 	// While reading from or writing to the cache, don't allow another thread entry.  This is because
 	// that thread (or this one) might write to the cache while the other one is reading/writing, which
@@ -12413,29 +12623,12 @@ pcre *get_compiled_regex(char *aRegEx, bool &aGetPositionsNotSubstrings, pcre_ex
 	// so like performance, that's not a concern either.
 	EnterCriticalSection(&g_CriticalRegExCache); // Request ownership of the critical section. If another thread already owns it, this thread will block until the other thread finishes.
 
-	// SET UP THE CACHE.
-	// This is a very crude cache for linear search. Of course, hashing would be better in the sense that it
-	// would allow the cache to get much larger while still being fast (I believe PHP caches up to 4096 items).
-	// Binary search might not be such a good idea in this case due to the time required to find the right spot
-	// to insert a new cache item (however, items aren't inserted often, so it might perform quite well until
-	// the cache contained thousands of RegEx's, which is unlikely to ever happen in most scripts).
-	struct pcre_cache_entry
-	{
-		// For simplicity (and thus performance), the entire RegEx pattern including its options is cached
-		// is stored in re_raw and that entire string becomes the RegEx's unique identifier for the purpose
-		// of finding an entry in the cache.  Technically, this isn't optimal because some options like Study
-		// and aGetPositionsNotSubstrings don't alter the nature of the compiled RegEx.  However, the CPU time
-		// required to strip off some options prior to doing a cache search seems likely to offset much of the
-		// cache's benefit.  So for this reason, as well as rarity and code size issues, this policy seems best.
-		char *re_raw;      // The RegEx's literal string pattern such as "abc.*123".
-		pcre *re_compiled; // The RegEx in compiled form.
-		pcre_extra *extra; // NULL unless a study() was done (and NULL even then if study() didn't find anything).
-		// int pcre_options; // Not currently needed in the cache since options are implicitly inside re_compiled.
-		bool get_positions_not_substrings;
-	};
+	if (aPin && sPinnedEntryCount >= PCRE_CACHE_MAX_PINNED) // Too many pinned; see comments above.
+	{
+		LeaveCriticalSection(&g_CriticalRegExCache);
+		return NULL;
+	}
 
-	#define PCRE_CACHE_SIZE 100 // Going too high would be counterproductive due to the slowness of linear search (and also the memory utilization of so many compiled RegEx's).
-	static pcre_cache_entry sCache[PCRE_CACHE_SIZE] = {{0}};
 	static int sLastInsert, sLastFound = -1; // -1 indicates "cache empty".
 	int insert_pos; // v1.0.45.03: This is used to avoid updating sLastInsert until an insert actually occurs (it might not occur if a compile error occurs in the regex, or something else stops it early).
 
@@ -12491,6 +12684,22 @@ pcre *get_compiled_regex(char *aRegEx, bool &aGetPositionsNotSubstrings, pcre_ex
 		// script loop that uses 50 unique RegEx's will quickly stabilize in the cache so that all 50 of them
 		// stay compiled/cached until the loop ends.
 		insert_pos = (sLastInsert == PCRE_CACHE_SIZE-1) ? 0 : sLastInsert + 1; // Formula works for both full and partially-full array.
+		// Skip over any entries currently pinned by callers.  Since no more than PCRE_CACHE_MAX_PINNED
+		// entries can be pinned, an unpinned one is found within one lap of the cache; the lap limit is
+		// only a safeguard.  This can't change insert_pos when the cache isn't yet full because the entry
+		// after sLastInsert is empty then.
+		for (i = 0; sCache[insert_pos].pin_count && i < PCRE_CACHE_SIZE; ++i)
+			insert_pos = (insert_pos == PCRE_CACHE_SIZE-1) ? 0 : insert_pos + 1;
+		if (sCache[insert_pos].pin_count) // Every entry is pinned, which the above should prevent.
+		{
+			if (aResultToken)
+			{
+				aResultToken->symbol = SYM_STRING;
+				aResultToken->marker = "";
+			}
+			LeaveCriticalSection(&g_CriticalRegExCache);
+			return NULL;
+		}
 	}
 	// Since the above didn't goto:
 	// - This RegEx isn't yet in the cache.  So compile it and put it in the cache, then return it to caller.
@@ -12606,6 +12815,7 @@ break_both:
 		}
 		goto error;
 	}
+	COUNT_EVENT(regex_compile);
 
 	if (do_study)
 	{
@@ -12650,6 +12860,9 @@ break_both:
 	this_entry.re_compiled = re_compiled;
 	this_entry.extra = aExtra;
 	this_entry.get_positions_not_substrings = aGetPositionsNotSubstrings;
+	this_entry.pin_count = aPin ? 1 : 0;
+	if (aPin)
+		++sPinnedEntryCount;
 	// "this_entry.pcre_options" doesn't exist because it isn't currently needed in the cache.  This is
 	// because the RE's options are implicitly stored inside re_compiled.
 
@@ -12664,6 +12877,8 @@ break_both:
 match_found: // RegEx was found in the cache at position sLastFound, so return the cached info back to the caller.
 	aGetPositionsNotSubstrings = sCache[sLastFound].get_positions_not_substrings;
 	aExtra = sCache[sLastFound].extra;
+	if (aPin && !sCache[sLastFound].pin_count++)
+		++sPinnedEntryCount;
 
 	LeaveCriticalSection(&g_CriticalRegExCache);
 	return sCache[sLastFound].re_compiled; // Indicate success.
@@ -12681,6 +12896,26 @@ error: // Since NULL is returned here, caller should ignore the contents of the
 
 
 
+void release_compiled_regex(pcre *aRE)
+// Undoes one pinning of aRE done by get_compiled_regex().  aRE may be NULL, in which case nothing is done.
+{
+	if (!aRE)
+		return;
+	EnterCriticalSection(&g_CriticalRegExCache);
+	for (int i = 0; i < PCRE_CACHE_SIZE; ++i)
+	{
+		if (sCache[i].re_compiled == aRE)
+		{
+			if (sCache[i].pin_count > 0 && !--sCache[i].pin_count)
+				--sPinnedEntryCount;
+			break;
+		}
+	}
+	LeaveCriticalSection(&g_CriticalRegExCache);
+}
+
+
+
 char *RegExMatch(char *aHaystack, char *aNeedleRegEx)
 // Returns NULL if no match.  Otherwise, returns the address where the pattern was found in aHaystack.
 {
@@ -12691,6 +12926,18 @@ char *RegExMatch(char *aHaystack, char *aNeedleRegEx)
 	// Compile the regex or get it from cache.
 	if (   !(re = get_compiled_regex(aNeedleRegEx, get_positions_not_substrings, extra, NULL))   ) // Compiling problem.
 		return NULL; // Our callers just want there to be "no match" in this case.
+	return RegExMatch(aHaystack, re, extra);
+}
+
+
+
+char *RegExMatch(char *aHaystack, pcre *aRE, pcre_extra *aExtra)
+// Same as the above but for callers that have already gotten aRE from get_compiled_regex(), such as a
+// window search that applies the same RegEx to every window.  aRE may be NULL to indicate that the
+// RegEx couldn't be compiled, in which case there is never a match.
+{
+	if (!aRE)
+		return NULL;
 
 	// Set up the offset array, which consists of int-pairs containing the start/end offset of each match.
 	// For simplicity, use a fixed size because even if it's too small (unlikely for our types of callers),
@@ -12699,7 +12946,7 @@ char *RegExMatch(char *aHaystack, char *aNeedleRegEx)
 	int offset[RXM_INT_COUNT];
 
 	// Execute the regex.
-	int captured_pattern_count = pcre_exec(re, extra, aHaystack, (int)strlen(aHaystack), 0, 0, offset, RXM_INT_COUNT);
+	int captured_pattern_count = pcre_exec(aRE, aExtra, aHaystack, (int)strlen(aHaystack), 0, 0, offset, RXM_INT_COUNT);
 	if (captured_pattern_count < 0) // PCRE_ERROR_NOMATCH or some kind of error.
 		return NULL;
 
@@ -14897,10 +15144,24 @@ void BIF_LV_AddInsertModify(ExprTokenType &aResultToken, ExprTokenType *aParam[]
 	// When the control has no rows, work around the fact that LVM_SETITEMCOUNT delivers less than 20%
 	// of its full benefit unless done after the first row is added (at least on XP SP1).  A non-zero
 	// row_count_hint tells us that this message should be sent after the row has been inserted/appended:
-	if (control.union_lv_attrib->row_count_hint > 0 && mode == 'I')
+	if (mode == 'I')
 	{
-		SendMessage(control.hwnd, LVM_SETITEMCOUNT, control.union_lv_attrib->row_count_hint, 0); // Last parameter should be 0 for LVS_OWNERDATA (verified if you look at the definition of ListView_SetItemCount macro).
-		control.union_lv_attrib->row_count_hint = 0; // Reset so that it only gets set once per request.
+		if (control.union_lv_attrib->row_count_hint > 0)
+		{
+			SendMessage(control.hwnd, LVM_SETITEMCOUNT, control.union_lv_attrib->row_count_hint, 0); // Last parameter should be 0 for LVS_OWNERDATA (verified if you look at the definition of ListView_SetItemCount macro).
+			control.union_lv_attrib->row_count_hint = 0; // Reset so that it only gets set once per request.
+		}
+		else
+		{
+			// Without a Count hint, the control enlarges its arrays of rows (and of each column's subitems)
+			// by only a small fixed number of rows at a time, so adding N rows copies those arrays about
+			// N/16 times, which makes loading a large ListView quadratic.  Avoid that by doubling the
+			// capacity each time the row count reaches a power of two.  LVM_SETITEMCOUNT never shrinks
+			// the capacity, so this doesn't undo a larger Count hint given earlier.
+			int row_count = ListView_GetItemCount(control.hwnd);
+			if (row_count >= LV_AUTO_GROW_MIN_ROWS && !(row_count & (row_count - 1)))
+				SendMessage(control.hwnd, LVM_SETITEMCOUNT, row_count * 2, 0);
+		}
 	}
 }
 
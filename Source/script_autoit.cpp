@@ -1372,6 +1372,8 @@ ResultType Line::FileRecycle(char *aFilePattern)
 	if (!aFilePattern || !*aFilePattern)
 		return g_ErrorLevel->Assign(ERRORLEVEL_ERROR);  // Since this is probably not what the user intended.
 
+	CloseCachedAppendFiles(aFilePattern); // Otherwise, a file FileAppend is keeping open couldn't be recycled.
+
 	SHFILEOPSTRUCT FileOp;
 	char szFileTemp[_MAX_PATH+2];
 
@@ -1468,6 +1470,8 @@ ResultType Line::FileGetVersion(char *aFilespec)
 
 bool Line::Util_CopyDir(const char *szInputSource, const char *szInputDest, bool bOverwrite)
 {
+	CloseCachedAppendFiles(); // Otherwise, any files FileAppend is keeping open couldn't be copied or moved.
+
 	// Get the fullpathnames and strip trailing \s
 	char szSource[_MAX_PATH+2];
 	char szDest[_MAX_PATH+2];
@@ -1528,6 +1532,8 @@ bool Line::Util_CopyDir(const char *szInputSource, const char *szInputDest, bool
 
 bool Line::Util_MoveDir(const char *szInputSource, const char *szInputDest, int OverwriteMode)
 {
+	CloseCachedAppendFiles(); // Otherwise, any files FileAppend is keeping open couldn't be copied or moved.
+
 	// Get the fullpathnames and strip trailing \s
 	char szSource[_MAX_PATH+2];
 	char szDest[_MAX_PATH+2];
@@ -1586,6 +1592,8 @@ bool Line::Util_MoveDir(const char *szInputSource, const char *szInputDest, int
 
 bool Line::Util_RemoveDir(const char *szInputSource, bool bRecurse)
 {
+	CloseCachedAppendFiles(); // Otherwise, any files FileAppend is keeping open couldn't be deleted.
+
 	SHFILEOPSTRUCT	FileOp;
 	char			szSource[_MAX_PATH+2];
 
@@ -1630,6 +1638,170 @@ bool Line::Util_RemoveDir(const char *szInputSource, bool bRecurse)
 // (moves files too)
 // Returns the number of files that could not be copied or moved due to error.
 ///////////////////////////////////////////////////////////////////////////////
+// Files at least this large are copied or moved on a worker thread (see BackgroundCopyOrMove()).  Smaller
+// ones are done directly because creating a thread costs more than the copy itself, and because a
+// wildcard copy of many small files already lets other threads run via LONG_OPERATION_UPDATE between files.
+#define BACKGROUND_COPY_MIN_SIZE (1024*1024)
+
+struct BackgroundCopyType
+{
+	const char *source, *dest;
+	bool move, fail_if_exists;
+};
+
+static DWORD WINAPI BackgroundCopyThread(LPVOID aParam)
+{
+	// This thread calls only the OS (never the C runtime, which isn't thread-safe in this build).
+	BackgroundCopyType &bc = *(BackgroundCopyType *)aParam;
+	return bc.move ? MoveFile(bc.source, bc.dest) : CopyFile(bc.source, bc.dest, bc.fail_if_exists);
+}
+
+
+
+// The workers currently being waited for by WaitForWorkerThreads(), so that WaitForFileTransfers() can
+// let them finish before the program exits.  It's a list because an OnExit subroutine (launched via the
+// tray menu during a wait) can start a transfer of its own:
+struct WorkerWaitType
+{
+	HANDLE *thread;
+	DWORD count;
+	WorkerWaitType *prev;
+};
+static WorkerWaitType *sWorkerWait = NULL;
+
+static DWORD WaitForWorkerThreads(HANDLE *aThread, DWORD aCount)
+// Waits until at least one of the threads in aThread[] has finished, keeping the program responsive
+// (e.g. GUI windows repaint) in the meantime.  Returns the index of a thread that has finished.
+{
+	// The current thread is made uninterruptible for the duration because hotkeys and timers that run
+	// during the wait could otherwise act upon the very files being transferred, or ExitApp/Reload while
+	// a worker is partway through writing a file.  They are buffered and run after the transfer instead.
+	// Exiting via the tray menu or logoff is still possible, so TerminateApp() calls WaitForFileTransfers().
+	WorkerWaitType wait = {aThread, aCount, sWorkerWait};
+	sWorkerWait = &wait;
+	BOOL allow_interruption_prev = g_AllowInterruption;
+	g_AllowInterruption = FALSE;
+	// Wake up as soon as a worker finishes or a message arrives.  The timeout is a safety net for
+	// messages MsgSleep() chooses to leave in the queue (e.g. since the current thread is uninterruptible),
+	// which would otherwise not wake MsgWaitForMultipleObjects() a second time.
+	DWORD result;
+	while ((result = MsgWaitForMultipleObjects(aCount, aThread, FALSE, SLEEP_INTERVAL, QS_ALLINPUT) - WAIT_OBJECT_0) >= aCount)
+		MsgSleep(-1);
+	g_AllowInterruption = allow_interruption_prev;
+	sWorkerWait = wait.prev;
+	return result;
+}
+
+
+
+void WaitForFileTransfers()
+// Called when the program is about to exit so that no file is left partially copied or moved.
+{
+	for (WorkerWaitType *wait = sWorkerWait; wait; wait = wait->prev)
+		WaitForMultipleObjects(wait->count, wait->thread, TRUE, INFINITE);
+}
+
+
+
+static BOOL BackgroundCopyOrMove(const char *aSource, const char *aDest, bool aMove, bool aFailIfExists)
+// Copies or moves a single large file on a worker thread.  The calling thread waits for it to finish,
+// so the command gives the same ErrorLevel and performs its operations in the same order as before.
+// But the wait is done via MsgSleep() so that the program's windows stay responsive while a large file
+// is transferred.  Hotkeys and timers are held until the transfer is done (see WaitForWorkerThreads()).
+// Returns the result of MoveFile()/CopyFile().
+{
+	BackgroundCopyType bc = {aSource, aDest, aMove, aFailIfExists}; // Stays valid because we don't return until the worker is done.
+	DWORD thread_id, result;
+	HANDLE thread = CreateThread(NULL, 0, BackgroundCopyThread, &bc, 0, &thread_id);
+	if (!thread) // Very rare, so just do it synchronously.
+		return BackgroundCopyThread(&bc);
+	WaitForWorkerThreads(&thread, 1);
+	GetExitCodeThread(thread, &result);
+	CloseHandle(thread);
+	return (BOOL)result;
+}
+
+
+
+// Number of files Util_CopyFile() may copy simultaneously when copying many files into a folder.
+// Each file still goes through CopyFile(); the gain comes from overlapping the per-file latency
+// (opening, creating and closing files, which dominates for small files and network shares).
+#define COPY_STREAM_COUNT 4
+
+struct CopyStreams
+{
+	HANDLE thread[COPY_STREAM_COUNT]; // NULL for a free slot.
+	BackgroundCopyType bc[COPY_STREAM_COUNT];
+	char source[COPY_STREAM_COUNT][MAX_PATH+1], dest[COPY_STREAM_COUNT][MAX_PATH+1];
+	int failure_count;
+
+	CopyStreams() : failure_count(0)
+	{
+		for (int i = 0; i < COPY_STREAM_COUNT; ++i)
+			thread[i] = NULL;
+	}
+	void Start(const char *aSource, const char *aDest, bool aFailIfExists);
+	bool WaitForOne();
+	int Finish()
+	{
+		while (WaitForOne());
+		return failure_count;
+	}
+};
+
+
+
+void CopyStreams::Start(const char *aSource, const char *aDest, bool aFailIfExists)
+// Starts copying aSource to aDest on a free stream, first waiting for one to become free if necessary.
+{
+	int i;
+	for (;;)
+	{
+		for (i = 0; i < COPY_STREAM_COUNT && thread[i]; ++i);
+		if (i < COPY_STREAM_COUNT)
+			break;
+		WaitForOne();
+	}
+	strcpy(source[i], aSource); // Caller has ensured both fit.
+	strcpy(dest[i], aDest);
+	bc[i].source = source[i];
+	bc[i].dest = dest[i];
+	bc[i].move = false;
+	bc[i].fail_if_exists = aFailIfExists;
+	DWORD thread_id;
+	if (   !(thread[i] = CreateThread(NULL, 0, BackgroundCopyThread, &bc[i], 0, &thread_id))   )
+		if (!BackgroundCopyThread(&bc[i])) // Very rare, so just do it synchronously.
+			++failure_count;
+}
+
+
+
+bool CopyStreams::WaitForOne()
+// Waits for any one copy to finish and frees its stream.  Returns false if none were in progress.
+{
+	HANDLE waiting[COPY_STREAM_COUNT];
+	int slot[COPY_STREAM_COUNT];
+	DWORD count = 0;
+	for (int j = 0; j < COPY_STREAM_COUNT; ++j)
+		if (thread[j])
+		{
+			waiting[count] = thread[j];
+			slot[count++] = j;
+		}
+	if (!count)
+		return false;
+	int i = slot[WaitForWorkerThreads(waiting, count)];
+	DWORD result;
+	GetExitCodeThread(thread[i], &result);
+	if (!result)
+		++failure_count;
+	CloseHandle(thread[i]);
+	thread[i] = NULL;
+	return true;
+}
+
+
+
 int Line::Util_CopyFile(const char *szInputSource, const char *szInputDest, bool bOverwrite, bool bMove)
 {
 	char			szSource[_MAX_PATH+1];
@@ -1641,6 +1813,10 @@ int Line::Util_CopyFile(const char *szInputSource, const char *szInputDest, bool
 	char			szFile[_MAX_PATH+1];
 	char			szExt[_MAX_PATH+1];
 
+	// Since the source may contain wildcards and the destination may be a directory, simply close all files
+	// FileAppend is keeping open, any of which would otherwise prevent the copy or move:
+	CloseCachedAppendFiles();
+
 	// Get local version of our source/dest with full path names, strip trailing \s
 	Util_GetFullPathName(szInputSource, szSource);
 	Util_GetFullPathName(szInputDest, szDest);
@@ -1664,6 +1840,14 @@ int Line::Util_CopyFile(const char *szInputSource, const char *szInputDest, bool
 	char *append_pos = szTempPath + szTempPath_length;
 	size_t space_remaining = sizeof(szTempPath) - szTempPath_length - 1;
 
+	// When copying into a folder under the same names (i.e. the destination is a folder or ends in *.*),
+	// no two source files can have the same destination, so the order in which they're copied doesn't
+	// matter and several can be copied at once.  Other cases are done one at a time because the outcome
+	// may depend on the order (e.g. "FileCopy, *.txt, All.txt, 1" keeps the last file copied).
+	char *dest_name = strrchr(szDest, '\\');
+	bool use_streams = !bMove && dest_name && !strcmp(dest_name + 1, "*.*");
+	CopyStreams streams;
+
 	int failure_count = 0;
 	LONG_OPERATION_INIT
 
@@ -1690,6 +1874,10 @@ int Line::Util_CopyFile(const char *szInputSource, const char *szInputDest, bool
 		// Expand the destination based on this found file
 		Util_ExpandFilenameWildcard(findData.cFileName, szDest, szExpandedDest);
 
+		// A move within the same volume is only a rename, but there's no cheap way to know that here,
+		// so large files go to the worker thread in both modes.
+		bool in_background = findData.nFileSizeHigh || findData.nFileSizeLow >= BACKGROUND_COPY_MIN_SIZE;
+
 		// Fixed for v1.0.36.01: This section has been revised to avoid unnecessary calls; but more
 		// importantly, it now avoids the deletion and complete loss of a file when it is copied or
 		// moved onto itself.  That used to happen because any existing destination file used to be
@@ -1711,26 +1899,32 @@ int Line::Util_CopyFile(const char *szInputSource, const char *szInputDest, bool
 			// physical file on disk (hopefully MoveFile handles all of these correctly by indicating
 			// success [below] when a file is moved onto itself, though it has only been tested for
 			// basic cases of relative vs. absolute path).
-			if (!MoveFile(szTempPath, szExpandedDest))
+			if (!(in_background ? BackgroundCopyOrMove(szTempPath, szExpandedDest, true, false)
+				: MoveFile(szTempPath, szExpandedDest)))
 			{
 				// If overwrite mode was not specified by the caller, or it was but the existing
 				// destination file cannot be deleted (perhaps because it is a folder rather than
 				// a file), or it can be deleted but the source cannot be moved, indicate a failure.
 				// But by design, continue the operation.  The following relies heavily on
 				// short-circuit boolean evaluation order:
-				if (   !(bOverwrite && DeleteFile(szExpandedDest) && MoveFile(szTempPath, szExpandedDest))   )
+				if (   !(bOverwrite && DeleteFile(szExpandedDest) && (in_background
+					? BackgroundCopyOrMove(szTempPath, szExpandedDest, true, false)
+					: MoveFile(szTempPath, szExpandedDest)))   )
 					++failure_count; // At this stage, any of the above 3 being false is cause for failure.
 				//else everything succeeded, so nothing extra needs to be done.  In either case,
 				// continue on to the next file.
 			}
 		}
+		else if (use_streams)
+			streams.Start(szTempPath, szExpandedDest, !bOverwrite);
 		else // The mode is "Copy" vs. "Move"
-			if (!CopyFile(szTempPath, szExpandedDest, !bOverwrite)) // Force it to fail if bOverwrite==false.
+			if (!(in_background ? BackgroundCopyOrMove(szTempPath, szExpandedDest, false, !bOverwrite)
+				: CopyFile(szTempPath, szExpandedDest, !bOverwrite))) // Force it to fail if bOverwrite==false.
 				++failure_count;
 	} while (FindNextFile(hSearch, &findData));
 
 	FindClose(hSearch);
-	return failure_count;
+	return failure_count + streams.Finish();
 }
 
 
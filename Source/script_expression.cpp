@@ -41,6 +41,7 @@ GNU General Public License for more details.
 #include "script.h"
 #include "globaldata.h" // for a lot of things
 #include "qmath.h" // For ExpandExpression()
+#include "profiler.h" // For COUNT_EVENT
 
 // __forceinline: Decided against it for this function because alhough it's only called by one caller,
 // testing shows that it wastes stack space (room for its automatic variables would be unconditionally 
@@ -129,6 +130,7 @@ char *Line::ExpandExpression(int aArgIndex, ResultType &aResult, char *&aTarget,
 		//    generate faster code.
 		ExprTokenType &this_token = *(ExprTokenType *)_alloca(sizeof(ExprTokenType)); // Saves a lot of stack space, and seems to perform just as well as something like the following (at the cost of ~82 byte increase in OBJ code size): ExprTokenType &this_token = new_token[new_token_count++]  // array size MAX_TOKENS
 		this_token = *this_postfix; // Struct copy. See comment section above.
+		COUNT_EVENT(token[this_token.symbol]);
 
 		// At this stage, operands in the postfix array should be SYM_OPERAND, SYM_STRING, or SYM_DYNAMIC.
 		// But all are checked since that operation is just as fast:
@@ -1691,6 +1693,7 @@ non_null_circuit_token:
 				LineError(ERR_OUTOFMEM ERR_ABORT);
 				goto abort;
 			}
+			COUNT_EVENT(expr_buf_expand);
 			if (new_buf_size > LARGE_DEREF_BUF_SIZE)
 				++sLargeDerefBufs; // And if the old deref buf was larger too, this value is decremented later below. SET_DEREF_TIMER() is handled by our caller because aDerefBufSize is updated further below, which the caller will see.
 
@@ -1846,6 +1849,7 @@ ResultType Line::ExpandArgs(VarSizeType aSpaceNeeded, Var *aArgVar[])
 		sDerefBufSize = new_buf_size;
 		if (sDerefBufSize > LARGE_DEREF_BUF_SIZE)
 			++sLargeDerefBufs;
+		COUNT_EVENT(deref_buf_expand);
 	}
 
 	// Always init our_buf_marker even if zero iterations, because we want to enforce
@@ -20,6 +20,7 @@ GNU General Public License for more details.
 #include "application.h" // for MsgSleep()
 #include "window.h" // for SetForegroundWindowEx()
 #include "qmath.h" // for qmathLog()
+#include "profiler.h" // for COUNT_EVENT
 
 
 ResultType Script::PerformGui(char *aCommand, char *aParam2, char *aParam3, char *aParam4)
@@ -349,6 +350,19 @@ return_the_result:
 
 
 
+static bool WindowTextIs(HWND aWnd, char *aText)
+// Returns true if aWnd's text is known to be identical to aText (case-sensitive).
+{
+	char buf[1024];
+	size_t length = strlen(aText);
+	if (length >= sizeof(buf) || (size_t)GetWindowTextLength(aWnd) != length) // The length can be larger than the actual (which merely causes false to be returned).
+		return false;
+	GetWindowText(aWnd, buf, sizeof(buf));
+	return !strcmp(buf, aText);
+}
+
+
+
 ResultType Line::GuiControl(char *aCommand, char *aControlID, char *aParam3)
 {
 	char *options; // This will contain something that is meaningful only when gui_command == GUICONTROL_CMD_OPTIONS.
@@ -817,6 +831,19 @@ ResultType Line::GuiControl(char *aCommand, char *aControlID, char *aParam3)
 		// 1) A control that uses the standard SetWindowText() method such as GUI_CONTROL_TEXT,
 		//    GUI_CONTROL_GROUPBOX, or GUI_CONTROL_BUTTON.
 		// 2) A radio or checkbox whose caption is being changed instead of its checked state.
+		// Scripts often refresh a display from a timer by setting every control's text each time, even
+		// though most of it hasn't changed.  Setting a control's text repaints it (and for a control with
+		// a transparent background, the part of the window behind it too), so skip controls that already
+		// have the text.  ComboBox is excluded because its selection was cleared above, which must still
+		// be reflected in its Edit field.  Picture is excluded because its image was just reloaded above
+		// (even when the filename, which is its text, is the same) and must still be redrawn below.
+		if (control.type != GUI_CONTROL_COMBOBOX && control.type != GUI_CONTROL_PIC
+			&& WindowTextIs(control.hwnd, aParam3))
+		{
+			COUNT_EVENT(gui_text_unchanged);
+			goto return_the_result;
+		}
+		COUNT_EVENT(gui_text_set);
 		SetWindowText(control.hwnd, aParam3); // Seems more reliable to set text before doing the redraw, plus it saves code size.
 		if (do_redraw_unconditionally)
 			break;
@@ -1447,6 +1474,7 @@ ResultType GuiType::Destroy(GuiIndexType aWindowIndex)
 	//gui.mControlCount = 0; // All child windows (controls) are automatically destroyed with parent.
 	HICON icon_eligible_for_destruction = gui.mIconEligibleForDestruction;
 	free(gui.mControl); // Free the control array, which was previously malloc'd.
+	free(gui.mControlByVar);
 	delete g_gui[aWindowIndex]; // After this, the var "gui" is invalid so should not be referenced, i.e. the next line.
 	g_gui[aWindowIndex] = NULL;
 	--sGuiCount; // This count is maintained to help performance in the main event loop and other places.
@@ -3441,6 +3469,7 @@ ResultType GuiType::AddControl(GuiControls aControlType, char *aOptions, char *a
 		return g_script.ScriptError("Can't create control." ERR_ABORT);
 	// Otherwise the above control creation succeeded.
 	++mControlCount;
+	ControlVarsChanged();
 	mControlWidthWasSetByContents = control_width_was_set_by_contents; // Set for use by next control, if any.
 	if (opt.hwnd_output_var) // v1.0.46.01.
 		opt.hwnd_output_var->AssignHWND(control.hwnd);
@@ -4982,6 +5011,7 @@ ResultType GuiType::ControlParseOptions(char *aOptions, GuiControlOptionsType &a
 					break;
 				case 'V':
 					aControl.output_var = NULL;
+					ControlVarsChanged();
 					break;
 				}
 				*option_end = orig_char; // Undo the temporary termination because the caller needs aOptions to be unaltered.
@@ -5081,6 +5111,7 @@ ResultType GuiType::ControlParseOptions(char *aOptions, GuiControlOptionsType &a
 							: g_script.ScriptError("The same variable cannot be used for more than one control." // It used to say "one control per window" but that seems more confusing than it's worth.
 								ERR_ABORT, next_option - 1);
 				aControl.output_var = candidate_var;
+				ControlVarsChanged();
 				break;
 
 			case 'E':  // Extended style
@@ -6769,9 +6800,8 @@ GuiIndexType GuiType::FindControl(char *aControlID)
 	{
 		// No need to do "var = var->ResolveAlias()" because the line above never finds locals, only globals.
 		// Similarly, there's no need to do confirm that var->IsLocal()==false.
-		for (u = 0; u < mControlCount; ++u)
-			if (mControl[u].output_var == var)
-				return u;  // Match found.
+		if ((u = FindControlByVar(var)) < mControlCount)
+			return u;  // Match found.
 	}
 	if (g->CurrentFunc // v1.0.46.15: Since above failed to match: if we're in a function (which is checked for performance reasons), search for a static or ByRef-that-points-to-a-global-or-static because both should be supported.
 		&& (var = g_script.FindVar(aControlID, 0, NULL, ALWAYS_USE_LOCAL)))
@@ -6779,10 +6809,9 @@ GuiIndexType GuiType::FindControl(char *aControlID)
 		// No need to do "var = var->ResolveAlias()" because the line above never finds locals, only globals.
 		// Similarly, there's no need to do confirm that var->IsLocal()==false.
 		var = var->ResolveAlias(); // Update it to its target if it's an alias because that's how control-var's are stored (i.e. pre-resolved, never aliases).
-		if (!var->IsNonStaticLocal()) // To be a valid control-var, it must be global, static, or a ByRef that points to a global or static.
-			for (u = 0; u < mControlCount; ++u)
-				if (mControl[u].output_var == var)
-					return u;  // Match found.
+		if (!var->IsNonStaticLocal() // To be a valid control-var, it must be global, static, or a ByRef that points to a global or static.
+			&& (u = FindControlByVar(var)) < mControlCount)
+			return u;  // Match found.
 	}
 	// Otherwise: No match found, so fall back to standard control class and/or text finding method.
 	HWND control_hwnd = ControlExist(mHwnd, aControlID);
@@ -6797,6 +6826,46 @@ GuiIndexType GuiType::FindControl(char *aControlID)
 
 
 
+#define CONTROL_BY_VAR_HASH(var) ((GuiIndexType)((size_t)(var) >> 4)) // Vars are at least 16 bytes apart.
+
+GuiIndexType GuiType::FindControlByVar(Var *aVar)
+// Returns the index of the control whose output_var is aVar, or NO_CONTROL_INDEX if none.
+// GuiControl and GuiControlGet look up their control this way every time they're called, so a hash
+// table is used rather than a scan of all controls, which is costly for windows with many controls that
+// are updated frequently (e.g. by a timer).  The table is rebuilt upon first use after any change.
+{
+	GuiIndexType u, i;
+	if (!mControlByVar)
+	{
+		// Use a table at least twice as large as the number of controls so that probe sequences stay short.
+		for (mControlByVarMask = 15; mControlByVarMask < mControlCount * 2; mControlByVarMask = mControlByVarMask * 2 + 1);
+		if (   !(mControlByVar = (GuiIndexType *)malloc((mControlByVarMask + 1) * sizeof(GuiIndexType)))   )
+		{
+			// Fall back to the simple method.
+			for (u = 0; u < mControlCount; ++u)
+				if (mControl[u].output_var == aVar)
+					return u;
+			return NO_CONTROL_INDEX;
+		}
+		for (i = 0; i <= mControlByVarMask; ++i)
+			mControlByVar[i] = NO_CONTROL_INDEX;
+		for (u = 0; u < mControlCount; ++u)
+			if (mControl[u].output_var) // Each var belongs to at most one control (enforced by ControlParseOptions).
+			{
+				for (i = CONTROL_BY_VAR_HASH(mControl[u].output_var) & mControlByVarMask
+					; mControlByVar[i] != NO_CONTROL_INDEX
+					; i = (i + 1) & mControlByVarMask);
+				mControlByVar[i] = u;
+			}
+	}
+	for (i = CONTROL_BY_VAR_HASH(aVar) & mControlByVarMask; (u = mControlByVar[i]) != NO_CONTROL_INDEX; i = (i + 1) & mControlByVarMask)
+		if (mControl[u].output_var == aVar)
+			return u;
+	return NO_CONTROL_INDEX;
+}
+
+
+
 int GuiType::FindGroup(GuiIndexType aControlIndex, GuiIndexType &aGroupStart, GuiIndexType &aGroupEnd)
 // Caller must provide a valid aControlIndex for an existing control.
 // Returns the number of radio buttons inside the group. In addition, it provides start and end
@@ -9281,6 +9350,9 @@ int CALLBACK LV_GeneralSort(LPARAM lParam1, LPARAM lParam2, LPARAM lParamSort)
 	// Then the ListView can be sorted via a method like the high performance LV_Int32Sort.
 	// However, since the above would require TWO SORTS, it would probably be slower (though the second sort would
 	// require only a tiny fraction of the time of the first).
+	// UPDATE: LV_SortByKeys() now does the above, but fetches each row's text only once rather than in every
+	// comparison, which makes it much faster for large lists.  This function is used only when there isn't
+	// enough memory for that.
 	lvs.lvi.pszText = lvs.buf1; // lvi's other members were already set by the caller.
 	if (lvs.incoming_is_index) // Serves to avoid the potentially high performance overhead of ListView_FindItem() where possible.
 	{
@@ -9355,6 +9427,125 @@ int CALLBACK LV_Int32Sort(LPARAM lParam1, LPARAM lParam2, LPARAM lParamSort)
 
 
 
+// The following are used by LV_KeySort(), which qsort() calls without any way to pass context.
+static LV_SortType *sLVSort;
+static char *sLVSortText;     // The column's text for all rows, back to back (wide if sorting logically).
+static UINT *sLVSortTextPos;  // Offset of each row's text within sLVSortText.
+static double *sLVSortFloat;  // For float columns, the column's value for all rows (instead of the above).
+
+int LV_KeySort(const void *a1, const void *a2)
+// Compares two row indices by their previously extracted keys (see LV_SortByKeys()).
+{
+	int row1 = *(int *)a1, row2 = *(int *)a2, result;
+	if (sLVSortFloat)
+	{
+		double f1 = sLVSortFloat[row1], f2 = sLVSortFloat[row2];
+		result = (f1 > f2) ? 1 : (f1 == f2 ? 0 : -1);
+	}
+	else if (sLVSort->col.case_sensitive == SCS_INSENSITIVE_LOGICAL) // See LV_GeneralSort() for details.
+		result = g_StrCmpLogicalW((LPCWSTR)(sLVSortText + sLVSortTextPos[row1]), (LPCWSTR)(sLVSortText + sLVSortTextPos[row2]));
+	else
+		result = strcmp2(sLVSortText + sLVSortTextPos[row1], sLVSortText + sLVSortTextPos[row2], sLVSort->col.case_sensitive);
+	if (!sLVSort->sort_ascending)
+		result = -result;
+	// Since qsort() isn't stable, break ties by current position so that rows with equal keys keep their order:
+	return result ? result : row1 - row2;
+}
+
+
+
+static bool LV_SortByKeys(LV_SortType &lvs, int aItemCount)
+// Sorts a text or float column by first fetching every row's text just once, then sorting the row indices
+// by those keys, and finally storing each row's new position as its lParam so that the ListView itself can
+// be sorted with the fast LV_Int32Sort().  This avoids LV_GeneralSort()'s two LVM_GETITEM messages (plus
+// the conversion of each float) for every one of the n*log(n) comparisons, which dominates for large lists.
+// Caller must have set up lvs as it would for LV_GeneralSort() with incoming_is_index==true.
+// Returns false (without having changed anything) if there wasn't enough memory, in which case the caller
+// should fall back to LV_GeneralSort().
+{
+	bool is_float = (lvs.col.type == LV_COL_FLOAT);
+	bool is_wide = !is_float && lvs.col.case_sensitive == SCS_INSENSITIVE_LOGICAL;
+	UINT msg_lvm_getitem = is_wide ? LVM_GETITEMW : LVM_GETITEM;
+	int *row = (int *)malloc(aItemCount * sizeof(int));
+	double *key_float = NULL;
+	UINT *text_pos = NULL;
+	char *text = NULL, *new_text;
+	size_t text_size = 0, text_length = 0, length;
+	if (!row)
+		return false;
+	if (is_float)
+		key_float = (double *)malloc(aItemCount * sizeof(double));
+	else
+	{
+		text_pos = (UINT *)malloc(aItemCount * sizeof(UINT));
+		text_size = aItemCount * 16; // Initial estimate; enlarged below as needed.
+		text = (char *)malloc(text_size);
+	}
+	if (is_float ? !key_float : !(text_pos && text))
+		goto fail;
+
+	int i;
+	for (i = 0; i < aItemCount; ++i)
+	{
+		row[i] = i;
+		lvs.lvi.iItem = i;
+		lvs.lvi.pszText = lvs.buf1;
+		if (!SendMessage(lvs.hwnd, msg_lvm_getitem, 0, (LPARAM)&lvs.lvi))
+			lvs.lvi.pszText = is_wide ? (LPSTR)L"" : ""; // Not an empty narrow string when wide because two zero bytes are needed.
+		// Must use lvi.pszText vs. buf1 for the reason given in LV_GeneralSort().
+		if (is_float)
+		{
+			key_float[i] = atof(lvs.lvi.pszText); // See LV_GeneralSort() for why atof() vs. ATOF().
+			continue;
+		}
+		length = is_wide ? (wcslen((LPCWSTR)lvs.lvi.pszText) + 1) * sizeof(WCHAR) : strlen(lvs.lvi.pszText) + 1;
+		if (text_length + length > text_size)
+		{
+			do
+				text_size *= 2;
+			while (text_length + length > text_size);
+			if (   !(new_text = (char *)realloc(text, text_size))   )
+				goto fail;
+			text = new_text;
+		}
+		memcpy(text + text_length, lvs.lvi.pszText, length);
+		text_pos[i] = (UINT)text_length;
+		text_length += length;
+	}
+
+	sLVSort = &lvs;
+	sLVSortText = text;
+	sLVSortTextPos = text_pos;
+	sLVSortFloat = key_float;
+	qsort(row, aItemCount, sizeof(int), LV_KeySort);
+
+	// row[] now lists the rows in their new order, so give each row its new position.
+	lvs.lvi.iSubItem = 0; // Indicate that an item vs. subitem is to be updated (subitems can't have an lParam).
+	lvs.lvi.mask = LVIF_PARAM;
+	for (i = 0; i < aItemCount; ++i)
+	{
+		lvs.lvi.iItem = row[i];
+		lvs.lvi.lParam = i;
+		ListView_SetItem(lvs.hwnd, &lvs.lvi);
+	}
+	SendMessage(lvs.hwnd, LVM_SORTITEMS, TRUE, (LPARAM)LV_Int32Sort); // TRUE because row[] is already in the requested direction.
+
+	free(row);
+	free(key_float);
+	free(text_pos);
+	free(text);
+	return true;
+
+fail:
+	free(row);
+	free(key_float);
+	free(text_pos);
+	free(text);
+	return false;
+}
+
+
+
 void GuiType::LV_Sort(GuiControlType &aControl, int aColumnIndex, bool aSortOnlyIfEnabled, char aForceDirection)
 // aForceDirection should be 'A' to force ascending, 'D' to force ascending, or '\0' to use the column's
 // current default direction.
@@ -9432,8 +9623,12 @@ void GuiType::LV_Sort(GuiControlType &aControl, int aColumnIndex, bool aSortOnly
 		lvs.lvi.iSubItem = aColumnIndex; // Zero-based column index to indicate whether the item or one of its sub-items should be retrieved.
 		lvs.col = col; // Struct copy, which should enhance sorting performance over a pointer.
 		lvs.incoming_is_index = true;
-		lvs.lvi.pszText = NULL; // Serves to detect whether the sort-proc actually ran (it won't if this is Win95 or some other OS that lacks SortEx).
 		lvs.lvi.mask = LVIF_TEXT;
+		if (LV_SortByKeys(lvs, item_count))
+			goto sort_done; // The methods below are used only when there isn't enough memory for that one.
+		lvs.lvi.mask = LVIF_TEXT;
+		lvs.lvi.iSubItem = aColumnIndex;
+		lvs.lvi.pszText = NULL; // Serves to detect whether the sort-proc actually ran (it won't if this is Win95 or some other OS that lacks SortEx).
 		SendMessage(aControl.hwnd, LVM_SORTITEMSEX, (WPARAM)&lvs, (LPARAM)LV_GeneralSort);
 		if (!lvs.lvi.pszText)
 		{
@@ -9456,6 +9651,7 @@ void GuiType::LV_Sort(GuiControlType &aControl, int aColumnIndex, bool aSortOnly
 		}
 	}
 
+sort_done:
 	// For simplicity, ListView_SortItems()'s return value (TRUE/FALSE) is ignored since it shouldn't
 	// realistically fail.  Just update things to indicate the current sort-column and direction:
 	lv_attrib.sorted_by_col = aColumnIndex;
@@ -29,6 +29,237 @@
 #include "globaldata.h"
 
 
+// IniRead keeps the most recently read INI files in memory, already split into sections and keys.
+// GetPrivateProfileString() opens, reads and scans the whole file for every key, which makes reading
+// many keys at startup slow.  A cached file is used only while its size and modification time, as
+// reported by a handle opened on the file itself, are unchanged.  IniWrite and IniDelete discard it
+// explicitly, and IniRead first closes any handle FileAppend is keeping open on the file so that its
+// buffered text is written and the file's time updated.  Changes made by other processes are detected
+// only through the size and time, so a change that leaves the size the same within the file system's
+// time resolution (2 seconds on FAT) might not be seen until the file changes again.  Writes still go
+// through WritePrivateProfileString() so that the file is always updated exactly as before.
+#define INI_CACHE_SIZE 4
+#define INI_CACHE_MAX_FILE_SIZE (1024*1024) // Larger files are left to the API rather than kept in memory.
+
+struct IniCacheSection
+{
+	char *name;
+	int first_key, key_count; // Range of this section's keys within IniCacheItem::key.
+};
+
+struct IniCacheKey
+{
+	char *name, *value;
+};
+
+struct IniCacheItem
+{
+	char path[_MAX_PATH+1]; // Empty if this item is unused.
+	FILETIME write_time;
+	DWORD size;
+	bool use_api; // True if this file must be read by the API (e.g. because it's Unicode).
+	char *text; // The file's contents, which the names and values below point into.
+	IniCacheSection *section;
+	IniCacheKey *key;
+	int section_count, key_count;
+	DWORD last_used;
+};
+
+static IniCacheItem sIniCache[INI_CACHE_SIZE]; // Zero-initialized.
+
+
+
+static void IniCacheFree(IniCacheItem &aItem)
+{
+	free(aItem.text);
+	free(aItem.section);
+	free(aItem.key);
+	aItem.text = NULL;
+	aItem.section = NULL;
+	aItem.key = NULL;
+	aItem.section_count = aItem.key_count = 0;
+	aItem.last_used = 0; // Makes it the first choice for reuse.
+	*aItem.path = '\0';
+}
+
+
+
+static void IniCacheInvalidate(char *aPath)
+{
+	for (int i = 0; i < INI_CACHE_SIZE; ++i)
+		if (*sIniCache[i].path && !stricmp(sIniCache[i].path, aPath))
+			IniCacheFree(sIniCache[i]);
+}
+
+
+
+static bool IniCacheParse(IniCacheItem &aItem)
+// Splits aItem.text into sections and keys in place, following the same rules as
+// GetPrivateProfileString(): names are case-insensitive and trimmed, lines starting with ';' are
+// comments, values are trimmed and lose any enclosing quotes, and only the first of any duplicate
+// sections or keys can be found.  Returns false if out of memory.
+{
+	// Each line yields at most one section or key, so the number of lines is enough for both:
+	int line_count = 1;
+	char *cp;
+	for (cp = aItem.text; *cp; ++cp)
+		if (*cp == '\n')
+			++line_count;
+	aItem.section = (IniCacheSection *)malloc(line_count * sizeof(IniCacheSection));
+	aItem.key = (IniCacheKey *)malloc(line_count * sizeof(IniCacheKey));
+	if (!aItem.section || !aItem.key)
+		return false;
+
+	char *line, *next_line, *text_end = cp, *equal_sign, *value; // cp was left pointing to the terminator.
+	size_t length, value_length;
+	for (line = aItem.text; line < text_end; line = next_line)
+	{
+		if (next_line = strchr(line, '\n'))
+			*next_line++ = '\0';
+		else
+			next_line = text_end;
+		length = strlen(line);
+		if (length && line[length - 1] == '\r')
+			line[--length] = '\0';
+		rtrim(line, length);
+		line = omit_leading_whitespace(line);
+		if (*line == '[')
+		{
+			IniCacheSection &section = aItem.section[aItem.section_count++];
+			section.name = omit_leading_whitespace(line + 1);
+			if (cp = strchr(section.name, ']'))
+				*cp = '\0';
+			rtrim(section.name);
+			section.first_key = aItem.key_count;
+			section.key_count = 0;
+			continue;
+		}
+		if (!aItem.section_count || *line == ';' || !(equal_sign = strchr(line, '=')))
+			continue; // Keys above the first section can't be read by the API either.
+		*equal_sign = '\0';
+		if (!rtrim(line))
+			continue;
+		value = omit_leading_whitespace(equal_sign + 1);
+		value_length = strlen(value);
+		if (value_length > 1 && (*value == '"' || *value == '\'') && value[value_length - 1] == *value)
+		{
+			value[value_length - 1] = '\0';
+			++value;
+		}
+		IniCacheKey &key = aItem.key[aItem.key_count++];
+		key.name = line;
+		key.value = value;
+		++aItem.section[aItem.section_count - 1].key_count;
+	}
+	return true;
+}
+
+
+
+static IniCacheItem *IniCacheGet(char *aPath)
+// Returns the cached copy of the INI file aPath (which must be a full path), loading it if necessary.
+// Returns NULL if the caller should use GetPrivateProfileString() instead.
+{
+	// Files in the Windows directory (such as win.ini and system.ini) might be mapped to the registry
+	// via IniFileMapping, and a path containing wildcards is left to the API to reject.
+	static char sWindowsDir[MAX_PATH];
+	static size_t sWindowsDirLength = 0;
+	if (!sWindowsDirLength)
+		sWindowsDirLength = GetWindowsDirectory(sWindowsDir, sizeof(sWindowsDir));
+	if (sWindowsDirLength && !strnicmp(aPath, sWindowsDir, sWindowsDirLength) || strpbrk(aPath, "*?"))
+		return NULL;
+
+	// Get the size and time from an open handle rather than FindFirstFile(), because the latter reports
+	// what is in the file's directory entry, which NTFS updates lazily while another handle has the file
+	// open for writing.  This also fails for directories, which are left to the API:
+	HANDLE hfile = CreateFile(aPath, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING
+		, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (hfile == INVALID_HANDLE_VALUE)
+		return NULL; // Let the API decide what to do with a missing file.
+	FILETIME write_time;
+	DWORD size;
+	if (   !GetFileTime(hfile, NULL, NULL, &write_time)
+		|| (size = GetFileSize(hfile, NULL)) > INI_CACHE_MAX_FILE_SIZE   ) // Also covers 0xFFFFFFFF (failure).
+	{
+		CloseHandle(hfile);
+		return NULL;
+	}
+
+	int i, lru = 0;
+	for (i = 0; i < INI_CACHE_SIZE; ++i)
+	{
+		if (*sIniCache[i].path && !stricmp(sIniCache[i].path, aPath))
+			break;
+		if (sIniCache[i].last_used < sIniCache[lru].last_used)
+			lru = i;
+	}
+	if (i < INI_CACHE_SIZE) // Found.
+	{
+		IniCacheItem &item = sIniCache[i];
+		if (item.size == size && !CompareFileTime(&item.write_time, &write_time))
+		{
+			CloseHandle(hfile);
+			item.last_used = GetTickCount();
+			return item.use_api ? NULL : &item;
+		}
+		lru = i; // The file has changed, so reload it into the same item.
+	}
+
+	IniCacheItem &item = sIniCache[lru];
+	IniCacheFree(item);
+	item.write_time = write_time;
+	item.size = size;
+	DWORD bytes_read;
+	if (   !(item.text = (char *)malloc(item.size + 1))
+		|| !ReadFile(hfile, item.text, item.size, &bytes_read, NULL)   )
+	{
+		CloseHandle(hfile);
+		IniCacheFree(item);
+		return NULL;
+	}
+	CloseHandle(hfile);
+	item.text[bytes_read] = '\0';
+	strcpy(item.path, aPath);
+	item.last_used = GetTickCount();
+
+	// The API reads UTF-16 files (and treats the UTF-8 byte order mark as part of the first line),
+	// so leave files with a byte order mark to it:
+	UCHAR *bom = (UCHAR *)item.text;
+	item.use_api = bytes_read > 1 && (bom[0] == 0xFF && bom[1] == 0xFE || bom[0] == 0xFE && bom[1] == 0xFF)
+		|| bytes_read > 2 && bom[0] == 0xEF && bom[1] == 0xBB && bom[2] == 0xBF;
+	if (item.use_api)
+	{
+		free(item.text); // Only the path, size and time are needed to remember this decision.
+		item.text = NULL;
+		return NULL;
+	}
+	if (!IniCacheParse(item))
+	{
+		IniCacheFree(item);
+		return NULL;
+	}
+	return &item;
+}
+
+
+
+static char *IniCacheFind(IniCacheItem &aItem, char *aSection, char *aKey)
+// Returns the value of aKey in aSection, or NULL if there is no such key.
+{
+	int i, k, k_end;
+	for (i = 0; i < aItem.section_count; ++i)
+		if (!stricmp(aItem.section[i].name, aSection))
+		{
+			for (k = aItem.section[i].first_key, k_end = k + aItem.section[i].key_count; k < k_end; ++k)
+				if (!stricmp(aItem.key[k].name, aKey))
+					return aItem.key[k].value;
+			break; // The API searches only the first section of a given name.
+		}
+	return NULL;
+}
+
+
+
 ResultType Line::IniRead(char *aFilespec, char *aSection, char *aKey, char *aDefault)
 {
 	if (!aDefault || !*aDefault)
@@ -38,7 +269,20 @@ ResultType Line::IniRead(char *aFilespec, char *aSection, char *aKey, char *aDef
 	char	szBuffer[65535] = "";					// Max ini file size is 65535 under 95
 	// Get the fullpathname (ini functions need a full path):
 	GetFullPathName(aFilespec, _MAX_PATH, szFileTemp, &szFilePart);
-	GetPrivateProfileString(aSection, aKey, aDefault, szBuffer, sizeof(szBuffer), szFileTemp);
+	// If FileAppend is keeping this file open, close it.  Although FileAppend flushes every write, some
+	// file systems don't update the file's modification time until the writing handle is closed, which
+	// would leave IniCacheGet() below unable to tell that the file has changed:
+	CloseCachedAppendFiles(szFileTemp);
+	IniCacheItem *ini = IniCacheGet(szFileTemp);
+	if (ini)
+	{
+		char *value = IniCacheFind(*ini, aSection, aKey);
+		strlcpy(szBuffer, value ? value : aDefault, sizeof(szBuffer));
+		if (!value)
+			rtrim(szBuffer); // Like the API, which strips trailing blanks from the default.
+	}
+	else
+		GetPrivateProfileString(aSection, aKey, aDefault, szBuffer, sizeof(szBuffer), szFileTemp);
 	// The above function is supposed to set szBuffer to be aDefault if it can't find the
 	// file, section, or key.  In other words, it always changes the contents of szBuffer.
 	return OUTPUT_VAR->Assign(szBuffer); // Avoid using the length the API reported because it might be inaccurate if the data contains any binary zeroes, or if the data is double-terminated, etc.
@@ -56,6 +300,7 @@ ResultType Line::IniWrite(char *aValue, char *aFilespec, char *aSection, char *a
 	GetFullPathName(aFilespec, _MAX_PATH, szFileTemp, &szFilePart);
 	BOOL result = WritePrivateProfileString(aSection, aKey, aValue, szFileTemp);  // Returns zero on failure.
 	WritePrivateProfileString(NULL, NULL, NULL, szFileTemp);	// Flush
+	IniCacheInvalidate(szFileTemp);
 	return g_script.mIsAutoIt2 ? OK : g_ErrorLevel->Assign(result ? ERRORLEVEL_NONE : ERRORLEVEL_ERROR);
 }
 
@@ -70,6 +315,7 @@ ResultType Line::IniDelete(char *aFilespec, char *aSection, char *aKey)
 	GetFullPathName(aFilespec, _MAX_PATH, szFileTemp, &szFilePart);
 	BOOL result = WritePrivateProfileString(aSection, aKey, NULL, szFileTemp);  // Returns zero on failure.
 	WritePrivateProfileString(NULL, NULL, NULL, szFileTemp);	// Flush
+	IniCacheInvalidate(szFileTemp);
 	return g_script.mIsAutoIt2 ? OK : g_ErrorLevel->Assign(result ? ERRORLEVEL_NONE : ERRORLEVEL_ERROR);
 }
 
@@ -17,6 +17,7 @@ GNU General Public License for more details.
 #include "stdafx.h" // pre-compiled headers
 #include "var.h"
 #include "globaldata.h" // for g_script
+#include "profiler.h" // for COUNT_EVENT
 
 
 // Init static vars:
@@ -551,6 +552,7 @@ ResultType Var::Assign(char *aBuf, VarSizeType aLength, bool aExactSize, bool aO
 				if (   !(new_mem = SimpleHeap::Malloc(new_size))   )
 					return FAIL; // It already displayed the error. Leave all var members unchanged so that they're consistent with each other. Don't bother making the var blank and its length zero for reasons described higher above.
 				mHowAllocated = ALLOC_SIMPLE;  // In case it was previously ALLOC_NONE. This step must be done only after the alloc succeeded.
+				COUNT_EVENT(var_alloc_simple);
 				break;
 			}
 			// ** ELSE DON'T BREAK, JUST FALL THROUGH TO THE NEXT CASE. **
@@ -608,6 +610,7 @@ ResultType Var::Assign(char *aBuf, VarSizeType aLength, bool aExactSize, bool aO
 			// This step must be done only after the alloc succeeded (because otherwise, want to keep it
 			// set to ALLOC_SIMPLE (fall-through), if that's what it was).
 			mHowAllocated = ALLOC_MALLOC;
+			COUNT_EVENT(var_alloc_malloc);
 			break;
 		} // switch()
 
@@ -941,6 +944,7 @@ void Var::AcceptNewMem(char *aNewMem, VarSizeType aLength)
 // Caller must ensure that mType == VAR_NORMAL or VAR_CLIPBOARD.
 // This function was added in v1.0.45 to aid callers in improving performance.
 {
+	COUNT_EVENT(var_accept_new_mem);
 	// Relies on the fact that aliases can't point to other aliases (enforced by UpdateAlias()).
 	Var &var = *(mType == VAR_ALIAS ? mAliasFor : this);
 	if (var.mType == VAR_CLIPBOARD)
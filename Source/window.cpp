@@ -1613,6 +1613,21 @@ ResultType WindowSearch::SetCriteria(global_struct &aSettings, char *aTitle, cha
 		}
 	}
 
+	// The compiled RegEx's are pinned in get_compiled_regex()'s cache so that they stay valid for the
+	// duration of the search even if the other thread (the hook thread via #IfWin, or the main thread)
+	// adds enough other RegEx's to the cache in the meantime to otherwise cause them to be discarded:
+	ReleaseRegEx();
+	if (aSettings.TitleMatchMode == FIND_REGEX)
+	{
+		bool get_positions_not_substrings; // Ignored.
+		mCriterionTitleRE = (mCriteria & CRITERION_TITLE) && *mCriterionTitle
+			? get_compiled_regex(mCriterionTitle, get_positions_not_substrings, mCriterionTitleExtra, NULL, true) : NULL;
+		mCriterionClassRE = (mCriteria & CRITERION_CLASS)
+			? get_compiled_regex(mCriterionClass, get_positions_not_substrings, mCriterionClassExtra, NULL, true) : NULL;
+		mCriterionExcludeTitleRE = *mCriterionExcludeTitle
+			? get_compiled_regex(mCriterionExcludeTitle, get_positions_not_substrings, mCriterionExcludeTitleExtra, NULL, true) : NULL;
+	}
+
 	// Since this function doesn't change mCandidateParent, there is no need to update the candidate's
 	// attributes unless the type of criterion has changed or if mExcludeTitle became non-blank as
 	// a result of our action above:
@@ -1672,7 +1687,8 @@ HWND WindowSearch::IsMatch(bool aInvert)
 				return NULL;
 			break;
 		case FIND_REGEX:
-			if (!RegExMatch(mCandidateTitle, mCriterionTitle))
+			if (mCriterionTitleRE ? !RegExMatch(mCandidateTitle, mCriterionTitleRE, mCriterionTitleExtra)
+				: !RegExMatch(mCandidateTitle, mCriterionTitle))
 				return NULL;
 			break;
 		default: // Exact match.
@@ -1686,7 +1702,8 @@ HWND WindowSearch::IsMatch(bool aInvert)
 	{
 		if (mSettings->TitleMatchMode == FIND_REGEX)
 		{
-			if (!RegExMatch(mCandidateClass, mCriterionClass))
+			if (mCriterionClassRE ? !RegExMatch(mCandidateClass, mCriterionClassRE, mCriterionClassExtra)
+				: !RegExMatch(mCandidateClass, mCriterionClass))
 				return NULL;
 		}
 		else // For backward compatibility, all other modes use exact-match for Class.
@@ -1734,7 +1751,8 @@ HWND WindowSearch::IsMatch(bool aInvert)
 				return NULL;
 			break;
 		case FIND_REGEX:
-			if (RegExMatch(mCandidateTitle, mCriterionExcludeTitle))
+			if (mCriterionExcludeTitleRE ? RegExMatch(mCandidateTitle, mCriterionExcludeTitleRE, mCriterionExcludeTitleExtra)
+				: RegExMatch(mCandidateTitle, mCriterionExcludeTitle))
 				return NULL;
 			break;
 		default: // Exact match.
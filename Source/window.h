@@ -99,6 +99,11 @@ public:
 	HWND mCriterionHwnd;                      // For "ahk_id".
 	DWORD mCriterionPID;                      // For "ahk_pid".
 	WinGroup *mCriterionGroup;                // For "ahk_group".
+	// For SetTitleMatchMode RegEx, SetCriteria() looks up each RegEx once so that IsMatch() doesn't have to
+	// do so for every candidate window.  Each non-NULL one is pinned in the RegEx cache until ReleaseRegEx()
+	// is called.  If one is NULL (it couldn't be compiled or pinned), IsMatch() looks it up for each window:
+	pcre *mCriterionTitleRE, *mCriterionClassRE, *mCriterionExcludeTitleRE;
+	pcre_extra *mCriterionTitleExtra, *mCriterionClassExtra, *mCriterionExcludeTitleExtra;
 
 	bool mFindLastMatch; // Whether to keep searching even after a match is found, so that last one is found.
 	int mFoundCount;     // Accumulates how many matches have been found (either 0 or 1 unless mFindLastMatch==true).
@@ -132,6 +137,14 @@ public:
 	void UpdateCandidateAttributes();
 	HWND IsMatch(bool aInvert = false);
 
+	void ReleaseRegEx()
+	{
+		release_compiled_regex(mCriterionTitleRE);
+		release_compiled_regex(mCriterionClassRE);
+		release_compiled_regex(mCriterionExcludeTitleRE);
+		mCriterionTitleRE = mCriterionClassRE = mCriterionExcludeTitleRE = NULL;
+	}
+
 	WindowSearch() // Constructor.
 		// For performance and code size, only the most essential members are initialized.
 		// The others do not require it or are intialized by SetCriteria() or SetCandidate().
@@ -139,6 +152,7 @@ public:
 		, mFoundCount(0), mFoundParent(NULL) // Must be initialized here since none of the member functions is allowed to do it.
 		, mFoundChild(NULL) // ControlExist() relies upon this.
 		, mCandidateParent(NULL)
+		, mCriterionTitleRE(NULL), mCriterionClassRE(NULL), mCriterionExcludeTitleRE(NULL) // Must be initialized for ReleaseRegEx().
 		// The following must be initialized because it's the object user's responsibility to override
 		// them in those relatively rare cases when they need to be.  WinGroup::ActUponAll() and
 		// WinGroup::Deactivate() (and probably other callers) rely on these attributes being retained
@@ -146,6 +160,10 @@ public:
 		, mFindLastMatch(false), mAlreadyVisited(NULL), mAlreadyVisitedCount(0), mFirstWinSpec(NULL), mArrayStart(NULL)
 	{
 	}
+	~WindowSearch()
+	{
+		ReleaseRegEx();
+	}
 };
 
 
@@ -192,8 +210,17 @@ struct length_and_buf_type
 	size_t total_length;
 	size_t capacity;
 	char *buf;
+	DWORD deadline; // Tick count after which no more controls are queried (used by WinGetText).
+	bool truncated; // Set to true if the above deadline or lack of memory stopped the enumeration early.
 };
 
+// WinGetText waits up to WINGETTEXT_TIMEOUT for each control, but no more than WINGETTEXT_TOTAL_TIMEOUT
+// for all of them together.  The total is a multiple of the per-control timeout so that a single hung
+// control doesn't prevent the text of the controls after it from being retrieved.  If the total expires,
+// the text retrieved so far is still returned but ErrorLevel is set to 1:
+#define WINGETTEXT_TIMEOUT 5000
+#define WINGETTEXT_TOTAL_TIMEOUT (4 * WINGETTEXT_TIMEOUT)
+
 struct class_and_hwnd_type
 {
 	char *class_name;